@@ -0,0 +1,78 @@
+/*---------------------------------------------------------------------------------
+
+PongDS - Simple Pong-like game for the Nintendo DS
+
+Bitmap assets and the decoder used for each of them. The encoding of an
+asset is set by the -gz option of its .grit file and the decoder by its
+entry in the manifest (source/assets.c), both must agree:
+
+    CODEC_RAW_DMA     -gz!   uncompressed, copied with DMA
+    CODEC_LZ77_BIOS   -gzl   BIOS LZ77 decoder (LZ77Vram)
+    CODEC_LZ77_FAST   -gzl   our LZ77 decoder, ARM code running from ITCM
+    CODEC_RLE         -gzr   BIOS RLE decoder (RLEVram)
+    CODEC_HUFFMAN     -gzh   BIOS Huffman decoder (writes 32 bits at a time)
+
+If they don't agree the data is decoded as it really is: compressed data
+by the BIOS decoder of the type in its header, an uncompressed bitmap
+with DMA. Data that is neither, or whose header asks for more than a
+bitmap, is not decoded at all.
+
+Author: Asier Iturralde Sarasola
+License: GPL v3
+
+---------------------------------------------------------------------------------*/
+
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <nds.h>
+
+enum asset_codecs {
+    CODEC_RAW_DMA = 0,
+    CODEC_LZ77_BIOS = 1,
+    CODEC_LZ77_FAST = 2,
+    CODEC_RLE = 3,
+    CODEC_HUFFMAN = 4,
+    CODEC_NONE = 0xFF   // the data is not a bitmap (see assetDecode())
+};
+
+// Every asset is a full screen 16 bit bitmap (the digits are not an asset)
+#define ASSET_BITMAP_SIZE (SCREEN_WIDTH * SCREEN_HEIGHT * 2)
+
+// The menus are in the same order as enum languages (EN, EU, ES, FR)
+enum asset_ids {
+    ASSET_SPLASH = 0,
+    ASSET_BACKGROUND,
+    ASSET_LANGUAGE_MENU,
+    ASSET_MAIN_MENU_EN,
+    ASSET_MAIN_MENU_EU,
+    ASSET_MAIN_MENU_ES,
+    ASSET_MAIN_MENU_FR,
+    ASSET_ONE_P_GAME_MENU_EN,
+    ASSET_ONE_P_GAME_MENU_EU,
+    ASSET_ONE_P_GAME_MENU_ES,
+    ASSET_ONE_P_GAME_MENU_FR,
+    ASSET_TWO_P_GAME_MENU_EN,
+    ASSET_TWO_P_GAME_MENU_EU,
+    ASSET_TWO_P_GAME_MENU_ES,
+    ASSET_TWO_P_GAME_MENU_FR,
+    ASSET_COUNT
+};
+
+typedef struct {
+    const char *name;
+    const void *data;
+    u32 rom_size;   // bytes in the ROM (as generated by grit)
+    u8 codec;
+} asset;
+
+extern const asset assets[ASSET_COUNT];
+
+u32 assetDecodedSize(const asset *a);
+bool assetDecode(const asset *a, u8 codec, void *dst);
+void assetLoad(int id, void *dst);
+
+// LZ77 decoder safe for VRAM (only 16 bit writes), see source/lz77.itcm.c
+ITCM_CODE void lz77DecodeVram(const void *source, void *dest);
+
+#endif
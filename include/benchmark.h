@@ -0,0 +1,22 @@
+/*---------------------------------------------------------------------------------
+
+PongDS - Simple Pong-like game for the Nintendo DS
+
+Benchmarks, only built with "make BENCHMARK=1". The results are shown on
+the sub screen and sent to the debug output of the emulator (no$gba,
+melonDS, DeSmuME) as lines starting with "PDSB".
+
+Author: Asier Iturralde Sarasola
+License: GPL v3
+
+---------------------------------------------------------------------------------*/
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+// Hardware timer used by the benchmarks (it also uses the next one)
+#define BENCHMARK_TIMER 0
+
+void runBenchmarks(void);
+
+#endif
@@ -0,0 +1,64 @@
+/*---------------------------------------------------------------------------------
+
+PongDS - Simple Pong-like game for the Nintendo DS
+
+The state of a game. It is plain data without pointers, so a copy of it
+(see snapshot.h) captures the whole game.
+
+Author: Asier Iturralde Sarasola
+License: GPL v3
+
+---------------------------------------------------------------------------------*/
+
+#ifndef GAME_STATE_H
+#define GAME_STATE_H
+
+#include <nds.h>
+#include <stdbool.h>
+
+#include "obstacles.h"
+
+typedef struct {
+   double x;
+   double y;
+   double speed;
+   int angle;
+} ball;
+
+typedef struct {
+    int x;
+    int y;          // pixel position, the integer part of fy
+    int speed;
+    int height;
+    int width;
+    int score;
+    f32 fy;         // sub-pixel position (20.12 fixed point, see paddle_control.h)
+    f32 vy;         // pixels per frame (20.12 fixed point)
+} paddle;
+
+enum state_options {
+    LANGUAGE_MENU = 0,
+    MAIN_MENU = 1,
+    ONE_PLAYER_GAME = 2,
+    TWO_PLAYERS_GAME = 3
+};
+
+enum languages {
+    EN = 0,
+    EU = 1,
+    ES = 2,
+    FR = 3
+};
+
+typedef struct {
+    ball b;
+    paddle p1;      // left paddle
+    paddle p2;      // right paddle
+    obstacle_grid grid;
+    unsigned int state;
+    unsigned int language;
+    bool game_ended;
+    bool obstacles_enabled;
+} game_state;
+
+#endif
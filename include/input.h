@@ -0,0 +1,27 @@
+/*---------------------------------------------------------------------------------
+
+PongDS - Simple Pong-like game for the Nintendo DS
+
+Keys and touch screen. With INPUT_SCRIPT defined (make PERF_TEST=1) the
+input comes from a script built into the ROM instead of the hardware,
+so the emulator performance test always plays the same game.
+
+Author: Asier Iturralde Sarasola
+License: GPL v3
+
+---------------------------------------------------------------------------------*/
+
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <nds.h>
+#include <stdbool.h>
+
+void inputScan(void);
+u32 inputDown(void);
+u32 inputHeld(void);
+u32 inputUp(void);
+void inputTouch(touchPosition *touch);
+bool inputScriptEnded(void);
+
+#endif
@@ -0,0 +1,60 @@
+/*---------------------------------------------------------------------------------
+
+PongDS - Simple Pong-like game for the Nintendo DS
+
+Background music streamed from the ROM filesystem (NitroFS). The file is
+read into a small ring buffer from the main loop and Maxmod takes the
+samples from the ring in its timer interrupt, so a track only costs
+MUSIC_RING_SIZE bytes of RAM, whatever its length.
+
+Author: Asier Iturralde Sarasola
+License: GPL v3
+
+---------------------------------------------------------------------------------*/
+
+#ifndef MUSIC_H
+#define MUSIC_H
+
+#include <nds.h>
+#include <stdbool.h>
+
+// Bytes of RAM for the stream (a power of two), it can be set from the Makefile
+#ifndef MUSIC_RING_SIZE
+#define MUSIC_RING_SIZE 8192
+#endif
+
+#if MUSIC_RING_SIZE <= 0 || (MUSIC_RING_SIZE & (MUSIC_RING_SIZE - 1))
+#error "MUSIC_RING_SIZE must be a power of two"
+#endif
+
+// Maximum bytes read from the ROM filesystem per call of musicUpdate()
+#define MUSIC_REFILL_CHUNK 1024
+
+// Length in samples of the buffer that Maxmod fills from the ring
+#define MUSIC_STREAM_BUFFER 1024
+
+// Hardware timer used by Maxmod to ask for more samples
+#define MUSIC_TIMER MM_TIMER0
+
+enum music_tracks {
+    MUSIC_MENU = 0,
+    MUSIC_MATCH = 1
+};
+
+typedef struct {
+    bool playing;
+    u32 underruns;          // times Maxmod asked for more samples than the ring had
+    u32 underrun_samples;   // samples replaced by silence
+    u32 fill;               // bytes in the ring right now
+    u32 min_fill;           // lowest fill since the last call of musicResetMinFill()
+    u32 bytes_read;         // bytes read from the ROM filesystem
+} music_stats;
+
+bool musicInit(void);
+void musicPlay(int track);
+void musicStop(void);
+void musicUpdate(void);
+void musicGetStats(music_stats *stats);
+void musicResetMinFill(void);
+
+#endif
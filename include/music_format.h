@@ -0,0 +1,51 @@
+/*---------------------------------------------------------------------------------
+
+PongDS - Simple Pong-like game for the Nintendo DS
+
+Format of the streamed music files (the .pdsm files in nitrofiles/music),
+shared by the game and the host tool (tools/pdsm.c). All the fields are little
+endian and the samples follow the header.
+
+Author: Asier Iturralde Sarasola
+License: GPL v3
+
+---------------------------------------------------------------------------------*/
+
+#ifndef MUSIC_FORMAT_H
+#define MUSIC_FORMAT_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define MUSIC_MAGIC "PDSM"
+
+// Bump it every time the layout of music_header or the samples change
+#define MUSIC_FORMAT_VERSION 1
+
+#define MUSIC_HEADER_SIZE 20
+
+enum music_sample_formats {
+    MUSIC_PCM8 = 0      // signed 8 bit mono PCM
+};
+
+typedef struct {
+    char magic[4];          // "PDSM"
+    uint16_t version;
+    uint16_t format;        // enum music_sample_formats
+    uint32_t sample_rate;   // in Hz
+    uint32_t sample_count;
+    uint32_t loop_start;    // sample where playback restarts at the end
+} music_header;
+
+//---------------------------------------------------------------------
+// True if the game can play a file with this header
+//---------------------------------------------------------------------
+static inline int musicHeaderValid(const music_header *h) {
+
+    return memcmp(h->magic, MUSIC_MAGIC, 4) == 0
+        && h->version == MUSIC_FORMAT_VERSION
+        && h->format == MUSIC_PCM8;
+
+}
+
+#endif
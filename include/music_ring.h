@@ -0,0 +1,85 @@
+/*---------------------------------------------------------------------------------
+
+PongDS - Simple Pong-like game for the Nintendo DS
+
+Indexing of the ring buffer of the music stream and the pieces of the
+track written to it (with the loop), shared by the game
+(source/music.c) and the self test of the host tool (tools/pdsm.c). The
+read and write positions run freely and wrap around the ring with a
+mask, so the size of the ring must be a power of two.
+
+Author: Asier Iturralde Sarasola
+License: GPL v3
+
+---------------------------------------------------------------------------------*/
+
+#ifndef MUSIC_RING_H
+#define MUSIC_RING_H
+
+#include <stdint.h>
+#include <string.h>
+
+//---------------------------------------------------------------------
+// Bytes that can be written at a position before the end of the ring
+//---------------------------------------------------------------------
+static inline uint32_t musicRingSpan(uint32_t size, uint32_t position) {
+
+    return size - (position & (size - 1));
+
+}
+
+//---------------------------------------------------------------------
+// Copies up to length bytes from position read (with write - read bytes
+// in the ring) and fills the rest of out with silence. Returns the
+// bytes copied.
+//---------------------------------------------------------------------
+static inline uint32_t musicRingRead(const int8_t *ring, uint32_t size, uint32_t read, uint32_t write,
+                                     int8_t *out, uint32_t length) {
+
+    uint32_t available = write - read;
+    uint32_t count = length < available ? length : available;
+    uint32_t first = musicRingSpan(size, read);
+
+    if (first > count) {
+        first = count;
+    }
+
+    memcpy(out, &ring[read & (size - 1)], first);
+    memcpy(out + first, ring, count - first);
+    memset(out + count, 0, length - count);
+
+    return count;
+}
+
+//---------------------------------------------------------------------
+// Next piece of the track to write at position write of the ring: the
+// samples from *position (moved back to loop_start at the end of the
+// track) up to todo, the end of the ring or the end of the track.
+// Returns 0 when the track is over and doesn't loop.
+//---------------------------------------------------------------------
+static inline uint32_t musicRingChunk(uint32_t size, uint32_t write, uint32_t todo, uint32_t *position,
+                                      uint32_t sample_count, uint32_t loop_start) {
+
+    uint32_t chunk = musicRingSpan(size, write);
+
+    if (*position >= sample_count) {
+
+        if (loop_start >= sample_count) {
+            return 0;
+        }
+
+        *position = loop_start;
+    }
+
+    if (chunk > todo) {
+        chunk = todo;
+    }
+
+    if (chunk > sample_count - *position) {
+        chunk = sample_count - *position;
+    }
+
+    return chunk;
+}
+
+#endif
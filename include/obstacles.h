@@ -0,0 +1,48 @@
+/*---------------------------------------------------------------------------------
+
+PongDS - Simple Pong-like game for the Nintendo DS
+
+Obstacle mode: destructible blocks drawn on a tile background layer of
+the main screen. The blocks are kept in a packed occupancy grid with one
+bit per 8x8 tile (one word per row of tiles), so the collision test of
+the ball is a few lookups whatever the number of blocks on screen.
+
+Author: Asier Iturralde Sarasola
+License: GPL v3
+
+---------------------------------------------------------------------------------*/
+
+#ifndef OBSTACLES_H
+#define OBSTACLES_H
+
+#include <nds.h>
+#include <stdbool.h>
+
+#define OBSTACLE_TILE_SIZE 8
+#define OBSTACLE_COLUMNS (SCREEN_WIDTH / OBSTACLE_TILE_SIZE)    // 32, one bit each in a u32
+#define OBSTACLE_ROWS (SCREEN_HEIGHT / OBSTACLE_TILE_SIZE)      // 24
+
+// Tile background layer of the main screen (map in VRAM A, see initScreensAndVRAM())
+#define OBSTACLE_BG_LAYER 1
+#define OBSTACLE_MAP_BASE 0
+#define OBSTACLE_TILE_BASE 1
+
+// Returned by obstaclesHit()
+#define OBSTACLE_HIT_X 1    // a block was hit on its left or right side
+#define OBSTACLE_HIT_Y 2    // a block was hit on its top or bottom side
+
+typedef struct {
+    u32 rows[OBSTACLE_ROWS];    // bit x of rows[y] is the tile (x, y)
+    u32 count;                  // blocks left
+} obstacle_grid;
+
+void obstaclesInit(void);
+void obstaclesReset(obstacle_grid *grid, bool enabled);
+void obstaclesShow(const obstacle_grid *grid, bool enabled);
+void obstaclesFill(obstacle_grid *grid, int count);
+void obstaclesDraw(const obstacle_grid *grid);
+void obstaclesSync(const obstacle_grid *from, const obstacle_grid *to);
+void obstacleDestroy(obstacle_grid *grid, int x, int y);
+int obstaclesHit(obstacle_grid *grid, int x, int y, int next_x, int next_y, int size);
+
+#endif
@@ -0,0 +1,63 @@
+/*---------------------------------------------------------------------------------
+
+PongDS - Simple Pong-like game for the Nintendo DS
+
+Paddle control schemes. The paddles move in 20.12 fixed point (the f32
+type of libnds), so speeds and accelerations can be fractions of a pixel.
+The response of each scheme is recorded in the telemetry: the frames from
+a new input until the paddle has moved PADDLE_RESPONSE_DISTANCE pixels
+that way, or is within a pixel of the stylus if it was closer.
+
+Author: Asier Iturralde Sarasola
+License: GPL v3
+
+---------------------------------------------------------------------------------*/
+
+#ifndef PADDLE_CONTROL_H
+#define PADDLE_CONTROL_H
+
+#include <nds.h>
+
+#include "game_state.h"
+
+enum control_schemes {
+    CONTROL_DIGITAL = 0,    // constant speed (paddle->speed pixels per frame) while a key is held
+    CONTROL_ACCEL = 1,      // speeds up while a key is held and slows down when it is released
+    CONTROL_TOUCH = 2,      // the paddle follows the stylus on the sub screen
+    CONTROL_SCHEME_COUNT = 3
+};
+
+// Acceleration curve of CONTROL_ACCEL, in pixels per frame
+#define PADDLE_START_SPEED floattof32(1.0)      // speed of the first frame, so the paddle moves at once
+#define PADDLE_ACCELERATION floattof32(0.25)    // added every frame the key is held
+#define PADDLE_DECELERATION floattof32(0.5)     // taken every frame without key (or when reversing)
+#define PADDLE_MAX_SPEED floattof32(4.0)
+
+// Fraction of the distance to the stylus covered each frame by CONTROL_TOUCH,
+// in 4096ths (20.12 fixed point, 2048 is 0.5): 4096 jumps to the stylus, lower
+// values filter the jitter of the touch screen but lag behind it. Set it with
+// "make clean && make PADDLE_TOUCH_SMOOTHING=4096"
+#ifndef PADDLE_TOUCH_SMOOTHING
+#define PADDLE_TOUCH_SMOOTHING 2048
+#endif
+
+#if PADDLE_TOUCH_SMOOTHING < 1 || PADDLE_TOUCH_SMOOTHING > 4096
+#error "PADDLE_TOUCH_SMOOTHING must be between 1 and 4096"
+#endif
+
+// Distance (the height of a paddle) of the response measurement
+#define PADDLE_RESPONSE_DISTANCE 32
+
+// A stylus press closer than this to the paddle is not measured, nor is the
+// jitter of the reading: only a new press or a move of the stylus of
+// PADDLE_RESPONSE_DISTANCE pixels starts a measurement of CONTROL_TOUCH
+#define PADDLE_TOUCH_DEAD_ZONE 4
+
+// No stylus on the screen (touch_y of paddleControlUpdate())
+#define PADDLE_NO_TOUCH -1
+
+void paddleControlReset(paddle *p, int player);
+void paddleControlUpdate(paddle *p, int player, int scheme, int direction, int touch_y);
+u32 paddleControlResponse(int player);
+
+#endif
@@ -0,0 +1,32 @@
+/*---------------------------------------------------------------------------------
+
+PongDS - Simple Pong-like game for the Nintendo DS
+
+Power management: sleep while the lid is closed and count the frames
+that do real work against the idle ones (menus and pause), which only
+wait for the vertical blank.
+
+Author: Asier Iturralde Sarasola
+License: GPL v3
+
+---------------------------------------------------------------------------------*/
+
+#ifndef POWER_H
+#define POWER_H
+
+#include <nds.h>
+#include <stdbool.h>
+
+typedef struct {
+    u32 active_frames;      // frames that simulated the game or changed the screens
+    u32 idle_frames;        // frames that skipped all the OAM and simulation work
+    u32 sleeps;             // times the lid was closed
+    u32 seconds_asleep;     // measured with the real time clock
+} power_stats;
+
+void powerInit(void);
+void powerSleep(void);
+void powerFrame(bool idle);
+void powerGetStats(power_stats *stats);
+
+#endif
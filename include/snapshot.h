@@ -0,0 +1,56 @@
+/*---------------------------------------------------------------------------------
+
+PongDS - Simple Pong-like game for the Nintendo DS
+
+Snapshots of the game state: a copy of the struct, a ring with the last
+SNAPSHOT_RING_SIZE frames to rewind the match (and its telemetry) and a
+compact versioned file format to save a match on the SD card and load
+it back.
+
+Author: Asier Iturralde Sarasola
+License: GPL v3
+
+---------------------------------------------------------------------------------*/
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <nds.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "game_state.h"
+
+// Frames that can be rewound (2 seconds)
+#define SNAPSHOT_RING_SIZE 120
+
+// Bump it every time the layout of the saved file changes
+#define SNAPSHOT_VERSION 2
+
+#define SNAPSHOT_FILE "fat:/pongds_save.bin"
+
+//---------------------------------------------------------------------
+// Copies the game state to a snapshot
+//---------------------------------------------------------------------
+static inline void snapshotTake(game_state *snapshot, const game_state *gs) {
+
+    memcpy(snapshot, gs, sizeof(game_state));
+
+}
+
+//---------------------------------------------------------------------
+// Copies a snapshot back to the game state
+//---------------------------------------------------------------------
+static inline void snapshotRestore(game_state *gs, const game_state *snapshot) {
+
+    memcpy(gs, snapshot, sizeof(game_state));
+
+}
+
+void snapshotRingClear(void);
+void snapshotPush(const game_state *gs);
+bool snapshotRewind(game_state *gs);
+bool snapshotSave(const game_state *gs);
+bool snapshotLoad(game_state *gs);
+
+#endif
@@ -0,0 +1,102 @@
+/*---------------------------------------------------------------------------------
+
+PongDS - Simple Pong-like game for the Nintendo DS
+
+Gameplay telemetry: a fixed-size ring of events recorded during a match
+and appended to a file on the SD card when the match ends.
+
+Author: Asier Iturralde Sarasola
+License: GPL v3
+
+---------------------------------------------------------------------------------*/
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <nds.h>
+#include <stdbool.h>
+
+// Bump it every time the layout of telemetry_header or telemetry_event changes
+#define TELEMETRY_VERSION 1
+
+// Number of events kept in RAM, it must be a power of two. A frame time
+// and a music sample every TELEMETRY_FRAME_INTERVAL frames are 240 events
+// per minute on their own, so 1024 dropped the start of long matches.
+#define TELEMETRY_CAPACITY 2048
+
+// Store a frame time sample every TELEMETRY_FRAME_INTERVAL frames
+#define TELEMETRY_FRAME_INTERVAL 30
+
+// Hardware timer used to measure the frame times (it also uses the next one)
+#define TELEMETRY_TIMER 2
+
+#define TELEMETRY_FILE "fat:/pongds_telemetry.bin"
+
+enum telemetry_event_types {
+    TELEMETRY_SERVE = 0,        // a: scoring side (0 = none), c: angle
+    TELEMETRY_PADDLE_HIT = 1,   // a: paddle (1 or 2), b: hit_y, c: new angle
+    TELEMETRY_WALL_BOUNCE = 2,  // a: 0 top, 1 bottom, 2 block, c: new angle
+    TELEMETRY_GOAL = 3,         // a: player that scored (1 or 2), b: new score of that player
+    TELEMETRY_FRAME_TIME = 4,   // c: bus clock ticks spent in the frame
+    TELEMETRY_MUSIC = 5,        // b: music underruns since the last one, c: lowest fill of the ring
+    TELEMETRY_PADDLE_LATENCY = 6, // a: control scheme, b: response in frames (see paddle_control.h), c: player
+    TELEMETRY_POWER = 7         // a: TELEMETRY_POWER_* metric, c: its value during the match (written when it ends)
+};
+
+// Metrics of the TELEMETRY_POWER events (see power.h)
+enum telemetry_power_metrics {
+    TELEMETRY_POWER_ACTIVE_FRAMES = 0,
+    TELEMETRY_POWER_IDLE_FRAMES = 1,
+    TELEMETRY_POWER_SLEEPS = 2,
+    TELEMETRY_POWER_SECONDS_ASLEEP = 3
+};
+
+// 12 bytes per event, written to the SD card as is (little endian)
+typedef struct {
+    u32 frame;  // frames since the start of the match
+    u8 type;
+    u8 a;
+    s16 b;
+    s32 c;
+} telemetry_event;
+
+// Written before the events of each match
+typedef struct {
+    char magic[4];      // "PDST"
+    u16 version;
+    u16 event_size;
+    u32 mode;           // ONE_PLAYER_GAME or TWO_PLAYERS_GAME
+    u32 frames;         // length of the match in frames
+    u32 event_count;    // number of events that follow this header
+    u32 dropped;        // events overwritten because the ring was full
+    s32 p1_score;
+    s32 p2_score;
+} telemetry_header;
+
+extern telemetry_event telemetry_ring[TELEMETRY_CAPACITY];
+extern u32 telemetry_head;
+extern u32 telemetry_frame;
+extern bool telemetry_active;
+
+void telemetryInit(void);
+void telemetryStartMatch(unsigned int mode);
+void telemetryFrame(void);
+bool telemetryFlush(int p1_score, int p2_score);
+
+//---------------------------------------------------------------------
+// Records an event in the ring, overwriting the oldest one when full
+//---------------------------------------------------------------------
+static inline void telemetryRecord(u8 type, u8 a, s16 b, s32 c) {
+
+    telemetry_event *e = &telemetry_ring[telemetry_head & (TELEMETRY_CAPACITY - 1)];
+
+    e->frame = telemetry_frame;
+    e->type = type;
+    e->a = a;
+    e->b = b;
+    e->c = c;
+
+    telemetry_head++;
+}
+
+#endif
@@ -0,0 +1,37 @@
+/*---------------------------------------------------------------------------------
+
+PongDS - Simple Pong-like game for the Nintendo DS
+
+Frame trace for the emulator performance test (make PERF_TEST=1). Every
+frame is reported on the debug output of the emulator (the no$gba debug
+message channel) as a line starting with "PDSF", the time from boot to
+the first frame as a line starting with "PDSI". Without FRAME_TRACE
+the calls compile to nothing.
+
+Author: Asier Iturralde Sarasola
+License: GPL v3
+
+---------------------------------------------------------------------------------*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <nds.h>
+#include <stdbool.h>
+
+#ifdef FRAME_TRACE
+
+void traceBoot(u32 ticks);
+void traceFrame(u32 ticks, u32 post_vblank_ticks, unsigned int state, bool idle);
+void traceEnd(void);
+
+#else
+
+#define traceBoot(ticks)
+// Without the trace the ticks are measured (two timer reads) but not used
+#define traceFrame(ticks, post_vblank_ticks, state, idle) ((void) (ticks), (void) (post_vblank_ticks))
+#define traceEnd()
+
+#endif
+
+#endif
@@ -0,0 +1,154 @@
+/*---------------------------------------------------------------------------------
+
+PongDS - Simple Pong-like game for the Nintendo DS
+
+Author: Asier Iturralde Sarasola
+License: GPL v3
+
+---------------------------------------------------------------------------------*/
+
+#include <nds.h>
+
+#include "assets.h"
+
+#include "background.h"
+#include <splash.h>
+#include <language_menu.h>
+#include <main_menu_en.h>
+#include <main_menu_eu.h>
+#include <main_menu_es.h>
+#include <main_menu_fr.h>
+#include <one_p_game_menu_en.h>
+#include <one_p_game_menu_eu.h>
+#include <one_p_game_menu_es.h>
+#include <one_p_game_menu_fr.h>
+#include <two_p_game_menu_en.h>
+#include <two_p_game_menu_eu.h>
+#include <two_p_game_menu_es.h>
+#include <two_p_game_menu_fr.h>
+
+// Compression types stored in the first byte of the grit data
+#define HEADER_LZ77 0x10
+#define HEADER_HUFFMAN 0x20
+#define HEADER_RLE 0x30
+
+#define ASSET(name, codec) { #name, name##Bitmap, name##BitmapLen, codec }
+
+//---------------------------------------------------------------------
+// The manifest: change the codec of an asset here and the -gz option
+// in its .grit file. Run a BENCHMARK=1 build to compare them.
+//---------------------------------------------------------------------
+const asset assets[ASSET_COUNT] = {
+    ASSET(splash, CODEC_LZ77_FAST),
+    ASSET(background, CODEC_LZ77_FAST),
+    ASSET(language_menu, CODEC_LZ77_FAST),
+    ASSET(main_menu_en, CODEC_LZ77_FAST),
+    ASSET(main_menu_eu, CODEC_LZ77_FAST),
+    ASSET(main_menu_es, CODEC_LZ77_FAST),
+    ASSET(main_menu_fr, CODEC_LZ77_FAST),
+    ASSET(one_p_game_menu_en, CODEC_LZ77_FAST),
+    ASSET(one_p_game_menu_eu, CODEC_LZ77_FAST),
+    ASSET(one_p_game_menu_es, CODEC_LZ77_FAST),
+    ASSET(one_p_game_menu_fr, CODEC_LZ77_FAST),
+    ASSET(two_p_game_menu_en, CODEC_LZ77_FAST),
+    ASSET(two_p_game_menu_eu, CODEC_LZ77_FAST),
+    ASSET(two_p_game_menu_es, CODEC_LZ77_FAST),
+    ASSET(two_p_game_menu_fr, CODEC_LZ77_FAST)
+};
+
+//---------------------------------------------------------------------
+// Codec that can decode the data of the asset: the given one if the data
+// is in that encoding, else the BIOS decoder of the encoding in its
+// header or a DMA copy if it is one uncompressed bitmap. CODEC_NONE if
+// it is neither, or if it would decode to more than a bitmap.
+//---------------------------------------------------------------------
+static u8 assetCodec(const asset *a, u8 codec) {
+
+    // The compressed data starts with a word: type | (decoded size << 8)
+    u32 header = *(const u32 *) a->data;
+    u8 type = header & 0xF0;
+    bool compressed = (type == HEADER_LZ77 || type == HEADER_HUFFMAN || type == HEADER_RLE)
+                      && (header >> 8) > 0 && (header >> 8) <= ASSET_BITMAP_SIZE;
+    bool raw = a->rom_size == ASSET_BITMAP_SIZE;
+
+    if (codec == CODEC_RAW_DMA && raw) {
+        return CODEC_RAW_DMA;
+    }
+
+    if (compressed) {
+
+        if (type == HEADER_HUFFMAN) {
+            return CODEC_HUFFMAN;
+        } else if (type == HEADER_RLE) {
+            return CODEC_RLE;
+        }
+
+        return codec == CODEC_LZ77_FAST ? CODEC_LZ77_FAST : CODEC_LZ77_BIOS;
+    }
+
+    return raw ? CODEC_RAW_DMA : CODEC_NONE;
+}
+
+//---------------------------------------------------------------------
+// Returns the size of the asset once decoded (0 if it can't be decoded)
+//---------------------------------------------------------------------
+u32 assetDecodedSize(const asset *a) {
+
+    u8 codec = assetCodec(a, a->codec);
+
+    if (codec == CODEC_NONE) {
+        return 0;
+    } else if (codec == CODEC_RAW_DMA) {
+        return a->rom_size;
+    }
+
+    return *(const u32 *) a->data >> 8;
+}
+
+//---------------------------------------------------------------------
+// Decodes the asset with the given codec. The codec must match the
+// encoding of the data; if it doesn't, the data is decoded as it really
+// is (see assetCodec). Returns false, without writing to dst, if the
+// data is not a bitmap in any encoding.
+//---------------------------------------------------------------------
+bool assetDecode(const asset *a, u8 codec, void *dst) {
+
+    switch (assetCodec(a, codec)) {
+
+        case CODEC_NONE:
+            return false;
+
+        case CODEC_RAW_DMA:
+            // The DMA reads the data from main RAM, make sure it is not in the cache only
+            DC_FlushRange(a->data, a->rom_size);
+            dmaCopy(a->data, dst, a->rom_size);
+            break;
+
+        case CODEC_LZ77_FAST:
+            lz77DecodeVram(a->data, dst);
+            break;
+
+        case CODEC_RLE:
+            decompress(a->data, dst, RLEVram);
+            break;
+
+        case CODEC_HUFFMAN:
+            decompress(a->data, dst, HUFF);
+            break;
+
+        default:
+            decompress(a->data, dst, LZ77Vram);
+
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------
+// Decodes the asset with the codec selected in the manifest
+//---------------------------------------------------------------------
+void assetLoad(int id, void *dst) {
+
+    assetDecode(&assets[id], assets[id].codec, dst);
+
+}
@@ -0,0 +1,387 @@
+/*---------------------------------------------------------------------------------
+
+PongDS - Simple Pong-like game for the Nintendo DS
+
+Author: Asier Iturralde Sarasola
+License: GPL v3
+
+---------------------------------------------------------------------------------*/
+
+#ifdef BENCHMARK
+
+#include <nds.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "assets.h"
+#include "benchmark.h"
+#include "obstacles.h"
+#include "paddle_control.h"
+#include "snapshot.h"
+
+#define BENCHMARK_RUNS 4
+
+// Ball positions tested for each number of obstacles
+#define COLLISION_TESTS 4096
+
+// Copies measured for each snapshot operation
+#define SNAPSHOT_TESTS 1024
+
+// Bus ticks in a frame (355 dots x 263 lines x 6 ticks per dot)
+#define FRAME_TICKS 560190
+
+static const char *codec_names[] = {"RAW", "L77B", "L77F", "RLE", "HUFF"};
+
+//---------------------------------------------------------------------
+// Prints a result line to the debug output of the emulator
+//---------------------------------------------------------------------
+static void debugPrint(const char *line) {
+
+    nocashMessage(line);
+
+}
+
+//---------------------------------------------------------------------
+// Decodes an asset to the main screen VRAM BENCHMARK_RUNS times and
+// returns the decoded bytes per millisecond
+//---------------------------------------------------------------------
+static u32 benchmarkDecode(const asset *a, u8 codec) {
+
+    char line[128];
+    u32 decoded = assetDecodedSize(a);
+    u32 ticks;
+    u32 bytes_per_ms;
+    int i;
+
+    if (decoded == 0) {
+        sprintf(line, "PDSB asset=%s codec=%s error=not_a_bitmap\n", a->name, codec_names[codec]);
+        debugPrint(line);
+        return 0;
+    }
+
+    cpuStartTiming(BENCHMARK_TIMER);
+
+    for (i = 0; i < BENCHMARK_RUNS; i++) {
+        assetDecode(a, codec, BG_GFX);
+    }
+
+    ticks = cpuEndTiming() / BENCHMARK_RUNS;
+
+    bytes_per_ms = ticks ? (u32) ((u64) decoded * (BUS_CLOCK / 1000) / ticks) : 0;
+
+    sprintf(line, "PDSB asset=%s codec=%s rom=%lu decoded=%lu ticks=%lu bytes_per_ms=%lu\n",
+            a->name, codec_names[codec], (unsigned long) a->rom_size, (unsigned long) decoded,
+            (unsigned long) ticks, (unsigned long) bytes_per_ms);
+    debugPrint(line);
+
+    return bytes_per_ms;
+}
+
+//---------------------------------------------------------------------
+// Shortens the name of an asset to fit in the console
+// (one_p_game_menu_en -> one_p_en, main_menu_en -> main_en)
+//---------------------------------------------------------------------
+static void shortName(const char *name, char *short_name) {
+
+    const char *p = name;
+
+    while (*p != '\0') {
+
+        if (strncmp(p, "_game_menu", 10) == 0) {
+            p += 10;
+        } else if (strncmp(p, "_menu", 5) == 0) {
+            p += 5;
+        } else {
+            *short_name++ = *p++;
+        }
+    }
+
+    *short_name = '\0';
+
+}
+
+//---------------------------------------------------------------------
+// Decode speed and ROM size of every asset with the codec of the
+// manifest. LZ77 assets are also decoded with the other LZ77 decoder.
+// Only the encoding in the ROM can be measured: change the .grit file
+// and the manifest to measure RLE or Huffman. The last row is the DMA
+// copy of an uncompressed bitmap (-gz!), made here from the splash
+// screen, its speed doesn't depend on the picture. The digits are
+// sprite tiles copied at boot, not an asset, and are not measured.
+//---------------------------------------------------------------------
+static void benchmarkAssets(void) {
+
+    char name[32];
+    u16 *bitmap;
+    int i;
+
+    iprintf("Asset decoding (bytes/ms)\n");
+    iprintf("asset      ROM codec  B/ms   alt\n");
+
+    for (i = 0; i < ASSET_COUNT; i++) {
+
+        const asset *a = &assets[i];
+        u32 speed = benchmarkDecode(a, a->codec);
+
+        shortName(a->name, name);
+
+        iprintf("%-10.10s%3luK%5s%6lu", name, (unsigned long) (a->rom_size + 1023) / 1024,
+                codec_names[a->codec], (unsigned long) speed);
+
+        if (a->codec == CODEC_LZ77_FAST) {
+            iprintf("%6lu\n", (unsigned long) benchmarkDecode(a, CODEC_LZ77_BIOS));
+        } else if (a->codec == CODEC_LZ77_BIOS) {
+            iprintf("%6lu\n", (unsigned long) benchmarkDecode(a, CODEC_LZ77_FAST));
+        } else {
+            iprintf("\n");
+        }
+    }
+
+    bitmap = malloc(ASSET_BITMAP_SIZE);
+
+    if (bitmap != NULL && assetDecode(&assets[ASSET_SPLASH], assets[ASSET_SPLASH].codec, BG_GFX)) {
+
+        asset raw = { "raw_bitmap", bitmap, ASSET_BITMAP_SIZE, CODEC_RAW_DMA };
+
+        memcpy(bitmap, BG_GFX, ASSET_BITMAP_SIZE);
+
+        iprintf("%-10.10s%3luK%5s%6lu\n", raw.name, (unsigned long) ASSET_BITMAP_SIZE / 1024,
+                codec_names[CODEC_RAW_DMA], (unsigned long) benchmarkDecode(&raw, CODEC_RAW_DMA));
+    }
+
+    free(bitmap);
+
+}
+
+//---------------------------------------------------------------------
+// Cost of the obstacle collision test of one frame for several numbers
+// of blocks. The grid is restored before each test (outside of the
+// measured time) and every number of blocks sees the same ball moves.
+//---------------------------------------------------------------------
+static void benchmarkCollision(void) {
+
+    static const int counts[] = {0, 64, 256, 512, 672};
+    obstacle_grid full, grid;
+    char line[96];
+    u32 overhead, start, ticks;
+    int i, j, hits;
+
+    // Cost of reading the timer, subtracted from every test
+    start = cpuGetTiming();
+    overhead = cpuGetTiming() - start;
+
+    iprintf("\nObstacle collision\n");
+    iprintf("blocks  hits  ticks/test\n");
+
+    for (i = 0; i < (int) (sizeof(counts) / sizeof(counts[0])); i++) {
+
+        obstaclesFill(&full, counts[i]);
+
+        srand(1);
+        ticks = 0;
+        hits = 0;
+
+        for (j = 0; j < COLLISION_TESTS; j++) {
+
+            int x = rand() % (SCREEN_WIDTH - 8);
+            int y = rand() % (SCREEN_HEIGHT - 8);
+            int dx = rand() % 5 - 2;
+            int dy = rand() % 5 - 2;
+
+            grid = full;
+
+            start = cpuGetTiming();
+            hits += obstaclesHit(&grid, x, y, x + dx, y + dy, 8) != 0;
+            ticks += cpuGetTiming() - start - overhead;
+        }
+
+        iprintf("%6d %5d %11lu\n", (int) full.count, hits, (unsigned long) (ticks / COLLISION_TESTS));
+
+        sprintf(line, "PDSB collision blocks=%lu hits=%d ticks_per_test=%lu\n",
+                (unsigned long) full.count, hits, (unsigned long) (ticks / COLLISION_TESTS));
+        debugPrint(line);
+    }
+
+}
+
+//---------------------------------------------------------------------
+// Prints the cost of one snapshot operation in ticks, ARM9 cycles (two
+// per tick) and hundredths of a percent of a frame
+//---------------------------------------------------------------------
+static void printSnapshotCost(const char *name, u32 ticks) {
+
+    char line[96];
+    u32 frame_permyriad = (u32) ((u64) ticks * 10000 / FRAME_TICKS);
+
+    iprintf("%-8s%6lu%7lu%4lu.%02lu%%\n", name, (unsigned long) ticks, (unsigned long) ticks * 2,
+            (unsigned long) frame_permyriad / 100, (unsigned long) frame_permyriad % 100);
+
+    sprintf(line, "PDSB snapshot op=%s ticks=%lu cycles=%lu frame_permyriad=%lu\n",
+            name, (unsigned long) ticks, (unsigned long) ticks * 2, (unsigned long) frame_permyriad);
+    debugPrint(line);
+
+}
+
+//---------------------------------------------------------------------
+// Cost of taking and restoring a snapshot of the game state and of
+// pushing it to (and rewinding it from) the ring, done once per frame
+//---------------------------------------------------------------------
+static void benchmarkSnapshot(void) {
+
+    static game_state gs, copy;
+    u32 overhead, start, take = 0, restore = 0, push = 0, rewind = 0;
+    int i;
+
+    memset(&gs, 0, sizeof(gs));
+    obstaclesFill(&gs.grid, 240);
+
+    start = cpuGetTiming();
+    overhead = cpuGetTiming() - start;
+
+    snapshotRingClear();
+
+    for (i = 0; i < SNAPSHOT_TESTS; i++) {
+
+        start = cpuGetTiming();
+        snapshotTake(&copy, &gs);
+        take += cpuGetTiming() - start - overhead;
+
+        start = cpuGetTiming();
+        snapshotRestore(&gs, &copy);
+        restore += cpuGetTiming() - start - overhead;
+
+        start = cpuGetTiming();
+        snapshotPush(&gs);
+        push += cpuGetTiming() - start - overhead;
+    }
+
+    for (i = 0; i < SNAPSHOT_RING_SIZE; i++) {
+        start = cpuGetTiming();
+        snapshotRewind(&gs);
+        rewind += cpuGetTiming() - start - overhead;
+    }
+
+    iprintf("\nSnapshot (%d bytes)\n", (int) sizeof(game_state));
+    iprintf("op       ticks cycles  frame\n");
+
+    printSnapshotCost("take", take / SNAPSHOT_TESTS);
+    printSnapshotCost("restore", restore / SNAPSHOT_TESTS);
+    printSnapshotCost("push", push / SNAPSHOT_TESTS);
+    printSnapshotCost("rewind", rewind / SNAPSHOT_RING_SIZE);
+
+}
+
+//---------------------------------------------------------------------
+// Paddle control schemes from a standstill: the response recorded in
+// the telemetry (frames to move PADDLE_RESPONSE_DISTANCE pixels), frames
+// to move 64 pixels, frames it keeps moving once the key (or the
+// stylus) is released and frames until it moves the other way when the
+// opposite key is held (the stylus jumps 64 pixels above)
+//---------------------------------------------------------------------
+static void benchmarkControl(void) {
+
+    static const char *scheme_names[] = {"digital", "accel", "touch"};
+    char line[160];
+    paddle p, q;
+    int scheme, frame, travel, stop, reverse, y;
+    u32 response;
+
+    iprintf("\nPaddle control (frames)\n");
+    iprintf("scheme   resp  64px  stop   rev\n");
+
+    for (scheme = 0; scheme < CONTROL_SCHEME_COUNT; scheme++) {
+
+        memset(&p, 0, sizeof(p));
+        p.y = 32;
+        p.speed = 2;
+        p.height = 32;
+        p.width = 8;
+
+        paddleControlReset(&p, 0);
+
+        travel = 0;
+
+        // Hold down, or put the stylus 64 pixels below the center of the paddle
+        for (frame = 1; frame <= 120 && travel == 0; frame++) {
+
+            paddleControlUpdate(&p, 0, scheme, 1, 32 + 64 + p.height / 2);
+
+            if (p.y >= 32 + 64) {
+                travel = frame;
+            }
+        }
+
+        response = paddleControlResponse(0);
+
+        // Reverse from the same state (as the second player, to keep the measurement above)
+        q = p;
+
+        stop = 0;
+        paddleControlUpdate(&p, 0, scheme, 0, PADDLE_NO_TOUCH);
+
+        while (p.vy != 0 && stop < 120) {
+            stop++;
+            paddleControlUpdate(&p, 0, scheme, 0, PADDLE_NO_TOUCH);
+        }
+
+        y = q.y;
+
+        for (reverse = 1; reverse <= 120; reverse++) {
+
+            paddleControlUpdate(&q, 1, scheme, -1, q.y + q.height / 2 - 64);
+
+            if (q.y < y) {
+                break;
+            }
+
+            y = q.y;
+        }
+
+        iprintf("%-8s%5lu%6d%6d%6d\n", scheme_names[scheme], (unsigned long) response, travel, stop, reverse);
+
+        sprintf(line, "PDSB control scheme=%s response_frames=%lu response_us=%lu travel_64_frames=%d stop_frames=%d reverse_frames=%d\n",
+                scheme_names[scheme], (unsigned long) response,
+                (unsigned long) ((u64) response * FRAME_TICKS * 1000000 / BUS_CLOCK), travel, stop, reverse);
+        debugPrint(line);
+    }
+
+}
+
+//---------------------------------------------------------------------
+// Runs all the benchmarks and waits forever
+//---------------------------------------------------------------------
+void runBenchmarks(void) {
+
+    // The results are printed on the sub screen, the main screen shows the decoded bitmaps
+    consoleDemoInit();
+
+    videoSetMode(MODE_5_2D);
+    vramSetBankA(VRAM_A_MAIN_BG);
+    bgInit(3, BgType_Bmp16, BgSize_B16_256x256, 0,0);
+
+    benchmarkAssets();
+
+    // The obstacle layer draws over the last decoded bitmap, it doesn't matter here
+    obstaclesInit();
+
+    cpuStartTiming(BENCHMARK_TIMER);
+
+    benchmarkCollision();
+
+    benchmarkSnapshot();
+
+    benchmarkControl();
+
+    cpuEndTiming();
+
+    iprintf("Done\n");
+    debugPrint("PDSB done\n");
+
+    while(1) {
+        swiWaitForVBlank();
+    }
+
+}
+
+#endif
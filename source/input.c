@@ -0,0 +1,116 @@
+/*---------------------------------------------------------------------------------
+
+PongDS - Simple Pong-like game for the Nintendo DS
+
+Author: Asier Iturralde Sarasola
+License: GPL v3
+
+---------------------------------------------------------------------------------*/
+
+#include <nds.h>
+
+#include "input.h"
+
+#ifdef INPUT_SCRIPT
+
+typedef struct {
+    u16 frames;     // how long the step lasts
+    u16 keys;       // keys held during the step
+    u8 x;           // touch position if KEY_TOUCH is held
+    u8 y;
+} input_step;
+
+// Taps on the menu buttons use the hit boxes of main()
+#define TAP(x, y) { 1, KEY_TOUCH, x, y }, { 30, 0, 0, 0 }
+#define RALLY { 40, KEY_UP, 0, 0 }, { 40, KEY_DOWN, 0, 0 }
+
+static const input_step input_script[] = {
+    { 60, 0, 0, 0 },    // let the splash screen settle
+    TAP(130, 63),       // English
+    TAP(130, 63),       // 1 player mode
+    RALLY, RALLY, RALLY, RALLY, RALLY, RALLY, RALLY, RALLY, RALLY, RALLY,
+    RALLY, RALLY, RALLY, RALLY, RALLY, RALLY, RALLY, RALLY, RALLY, RALLY,
+    TAP(130, 87),       // back to the main menu
+    TAP(130, 87),       // 2 players mode
+    RALLY, RALLY, RALLY, RALLY, RALLY, RALLY, RALLY, RALLY, RALLY, RALLY,
+    TAP(130, 87),       // back to the main menu
+};
+
+#define INPUT_SCRIPT_STEPS (sizeof(input_script) / sizeof(input_script[0]))
+
+static u32 input_step_index = 0;
+static u32 input_step_frame = 0;
+static u32 input_held = 0;
+static u32 input_previous = 0;
+static touchPosition input_touch;
+
+//---------------------------------------------------------------------
+// Advances the script one frame
+//---------------------------------------------------------------------
+void inputScan(void) {
+
+    input_previous = input_held;
+
+    if (input_step_index >= INPUT_SCRIPT_STEPS) {
+        input_held = 0;
+        return;
+    }
+
+    input_held = input_script[input_step_index].keys;
+    input_touch.px = input_script[input_step_index].x;
+    input_touch.py = input_script[input_step_index].y;
+
+    if (++input_step_frame >= input_script[input_step_index].frames) {
+        input_step_frame = 0;
+        input_step_index++;
+    }
+
+}
+
+u32 inputDown(void) {
+    return input_held & ~input_previous;
+}
+
+u32 inputHeld(void) {
+    return input_held;
+}
+
+u32 inputUp(void) {
+    return input_previous & ~input_held;
+}
+
+void inputTouch(touchPosition *touch) {
+    *touch = input_touch;
+}
+
+bool inputScriptEnded(void) {
+    return input_step_index >= INPUT_SCRIPT_STEPS;
+}
+
+#else
+
+void inputScan(void) {
+    scanKeys();
+}
+
+u32 inputDown(void) {
+    return keysDown();
+}
+
+u32 inputHeld(void) {
+    return keysHeld();
+}
+
+u32 inputUp(void) {
+    return keysUp();
+}
+
+void inputTouch(touchPosition *touch) {
+    touchRead(touch);
+}
+
+bool inputScriptEnded(void) {
+    return false;
+}
+
+#endif
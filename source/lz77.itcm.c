@@ -0,0 +1,102 @@
+/*---------------------------------------------------------------------------------
+
+PongDS - Simple Pong-like game for the Nintendo DS
+
+LZ77 decoder (the format generated by grit -gzl and decoded by the BIOS)
+that only writes 16 bits at a time, so it can decode straight to VRAM.
+The .itcm.c suffix makes the Makefile compile it as ARM code and the
+linker place it in ITCM, where it runs without waiting for main RAM.
+
+Author: Asier Iturralde Sarasola
+License: GPL v3
+
+---------------------------------------------------------------------------------*/
+
+#include <nds.h>
+
+#include "assets.h"
+
+//---------------------------------------------------------------------
+// Decodes source to dest. The bytes are paired in halfwords before
+// writing them; back references read the bytes already in dest (VRAM
+// can be read 8 bits at a time) or the pending byte of the last pair.
+//---------------------------------------------------------------------
+ITCM_CODE void lz77DecodeVram(const void *source, void *dest) {
+
+    const u8 *src = (const u8 *) source;
+    const u8 *out_bytes = (const u8 *) dest;
+    u16 *out = (u16 *) dest;
+    u32 size = src[1] | (src[2] << 8) | (src[3] << 16);
+    u32 pos = 0;        // bytes decoded so far
+    u32 pending = 0;    // low byte of the halfword being built when pos is odd
+
+    src += 4;
+
+    while (pos < size) {
+
+        u32 flags = *src++;
+        int i;
+
+        for (i = 0; i < 8 && pos < size; i++, flags <<= 1) {
+
+            if (flags & 0x80) {
+
+                // Back reference: 4 bits of length - 3, 12 bits of displacement - 1
+                u32 len = (src[0] >> 4) + 3;
+                u32 disp = (((src[0] & 0x0F) << 8) | src[1]) + 1;
+
+                src += 2;
+
+                if (len > size - pos) {
+                    len = size - pos;
+                }
+
+                // Both ends aligned: copy whole halfwords from VRAM
+                if (!(pos & 1) && !(disp & 1)) {
+
+                    u16 *from = out + ((pos - disp) >> 1);
+                    u16 *to = out + (pos >> 1);
+                    u32 pairs = len >> 1;
+
+                    pos += pairs << 1;
+                    len &= 1;
+
+                    for (; pairs > 0; pairs--) {
+                        *to++ = *from++;
+                    }
+
+                }
+
+                for (; len > 0; len--) {
+
+                    u32 value = ((pos & 1) && disp == 1) ? pending : out_bytes[pos - disp];
+
+                    if (pos & 1) {
+                        out[pos >> 1] = pending | (value << 8);
+                    } else {
+                        pending = value;
+                    }
+
+                    pos++;
+                }
+
+            } else {
+
+                // Literal byte
+                if (pos & 1) {
+                    out[pos >> 1] = pending | (*src++ << 8);
+                } else {
+                    pending = *src++;
+                }
+
+                pos++;
+            }
+        }
+    }
+
+    // Odd sizes leave the last byte pending
+    if (pos & 1) {
+        out[pos >> 1] = pending;
+    }
+
+}
@@ -18,22 +18,19 @@ License: GPL v3
 #include "soundbank.h"
 #include "soundbank_bin.h"
 
-#include "background.h"
+#include "assets.h"
+#include "benchmark.h"
+#include "game_state.h"
+#include "input.h"
+#include "music.h"
+#include "obstacles.h"
+#include "paddle_control.h"
+#include "power.h"
+#include "snapshot.h"
+#include "telemetry.h"
+#include "trace.h"
+
 #include <digits.h>
-#include <splash.h>
-#include <language_menu.h>
-#include <main_menu_en.h>
-#include <main_menu_eu.h>
-#include <main_menu_es.h>
-#include <main_menu_fr.h>
-#include <one_p_game_menu_en.h>
-#include <one_p_game_menu_eu.h>
-#include <one_p_game_menu_es.h>
-#include <one_p_game_menu_fr.h>
-#include <two_p_game_menu_en.h>
-#include <two_p_game_menu_eu.h>
-#include <two_p_game_menu_es.h>
-#include <two_p_game_menu_fr.h>
 
 #define DEGREE_TO_RADIAN 0.01745329251
 #define INITIAL_SPEED 1.5
@@ -44,37 +41,14 @@ License: GPL v3
 #define PADDLE_WIDTH 8
 #define SCORE_LIMIT 10
 
+// The bitmaps of the main screen start at 128 KB (VRAM D), VRAM A holds the obstacles layer
+#define BITMAP_MAP_BASE 8
+
 int initial_angles[] = {120, 180, 240, 300, 0, 60};
 
-typedef struct {
-   double x;
-   double y;
-   double speed;
-   int angle;
-} ball;
-
-typedef struct {
-    int x;
-    int y;
-    int speed;
-    int height;
-    int width;
-    int score;
-} paddle;
-
-enum state_options {
-    LANGUAGE_MENU = 0,
-    MAIN_MENU = 1,
-    ONE_PLAYER_GAME = 2,
-    TWO_PLAYERS_GAME = 3
-};
-
-enum languages {
-    EN = 0,
-    EU = 1,
-    ES = 2,
-    FR = 3
-};
+// True while L is held to rewind the match. L must be pressed during the
+// match: holding it from the menu (obstacle mode) doesn't rewind.
+bool rewinding = false;
 
 //---------------------------------------------------------------------
 // Returns a random number between 0 and limit inclusive
@@ -105,6 +79,7 @@ void initScreensAndVRAM() {
     vramSetBankA(VRAM_A_MAIN_BG);
     vramSetBankB(VRAM_B_MAIN_SPRITE);
     vramSetBankC(VRAM_C_SUB_BG);
+    vramSetBankD(VRAM_D_MAIN_BG_0x06020000);
 
 }
 
@@ -129,8 +104,8 @@ void initDigits(u8* gfx, u16* sprite_gfx_mem[]) {
 int showSplash() {
 
     // set up the bitmap background of the main screen (splash screen)
-	bgInit(3, BgType_Bmp16, BgSize_B16_256x256, 0,0);
-    decompress(splashBitmap, BG_GFX,  LZ77Vram);
+	int bg = bgInit(3, BgType_Bmp16, BgSize_B16_256x256, BITMAP_MAP_BASE,0);
+    assetLoad(ASSET_SPLASH, bgGetGfxPtr(bg));
 
     return 0;
 }
@@ -143,51 +118,27 @@ int showMenu(int state, unsigned int language) {
     // set up the bitmap background of the main menu on the sub screen
 	bgInitSub(3, BgType_Bmp16, BgSize_B16_256x256, 0,0);
 
+    // The localized menus are in the same order as enum languages
     switch (state) {
 
         case LANGUAGE_MENU:
-            decompress(language_menuBitmap, BG_GFX_SUB,  LZ77Vram);
+            assetLoad(ASSET_LANGUAGE_MENU, BG_GFX_SUB);
             break;
 
         case MAIN_MENU:
-
-            if (language == EN) {
-                decompress(main_menu_enBitmap, BG_GFX_SUB,  LZ77Vram);
-            } else if (language == EU) {
-                decompress(main_menu_euBitmap, BG_GFX_SUB,  LZ77Vram);
-            } else if (language == ES) {
-                decompress(main_menu_esBitmap, BG_GFX_SUB,  LZ77Vram);
-            } else if (language == FR) {
-                decompress(main_menu_frBitmap, BG_GFX_SUB,  LZ77Vram);
-            }
+            assetLoad(ASSET_MAIN_MENU_EN + language, BG_GFX_SUB);
             break;
 
         case ONE_PLAYER_GAME:
-            if (language == EN) {
-                decompress(one_p_game_menu_enBitmap, BG_GFX_SUB,  LZ77Vram);
-            } else if (language == EU) {
-                decompress(one_p_game_menu_euBitmap, BG_GFX_SUB,  LZ77Vram);
-            } else if (language == ES) {
-                decompress(one_p_game_menu_esBitmap, BG_GFX_SUB,  LZ77Vram);
-            } else if (language == FR) {
-                decompress(one_p_game_menu_frBitmap, BG_GFX_SUB,  LZ77Vram);
-            }
+            assetLoad(ASSET_ONE_P_GAME_MENU_EN + language, BG_GFX_SUB);
             break;
 
         case TWO_PLAYERS_GAME:
-            if (language == EN) {
-                decompress(two_p_game_menu_enBitmap, BG_GFX_SUB,  LZ77Vram);
-            } else if (language == EU) {
-                decompress(two_p_game_menu_euBitmap, BG_GFX_SUB,  LZ77Vram);
-            } else if (language == ES) {
-                decompress(two_p_game_menu_esBitmap, BG_GFX_SUB,  LZ77Vram);
-            } else if (language == FR) {
-                decompress(two_p_game_menu_frBitmap, BG_GFX_SUB,  LZ77Vram);
-            }
+            assetLoad(ASSET_TWO_P_GAME_MENU_EN + language, BG_GFX_SUB);
             break;
 
         default:
-            decompress(language_menuBitmap, BG_GFX_SUB,  LZ77Vram);
+            assetLoad(ASSET_LANGUAGE_MENU, BG_GFX_SUB);
 
     }
 
@@ -196,36 +147,74 @@ int showMenu(int state, unsigned int language) {
 }
 
 //---------------------------------------------------------------------
-// Initializes the game field
+// Button of the menu of the current state under the stylus (1 to 4 from
+// the top), or 0 if there is none. The matches only have two buttons.
 //---------------------------------------------------------------------
-int initGameField() {
+int touchButton(const touchPosition *touch, unsigned int state) {
 
-    // set up the bitmap background of the main screen (game field)
-    bgInit(3, BgType_Bmp16, BgSize_B16_256x256, 0,0);
-    decompress(backgroundBitmap, BG_GFX,  LZ77Vram);
+    int button = 0;
+
+    if (touch->px < 52 || touch->px > 211) {
+        return 0;
+    }
+
+    if (touch->py >= 53 && touch->py <= 73) {
+        button = 1;
+    } else if (touch->py >= 77 && touch->py <= 97) {
+        button = 2;
+    } else if (touch->py >= 103 && touch->py <= 123) {
+        button = 3;
+    } else if (touch->py >= 128 && touch->py <= 148) {
+        button = 4;
+    }
+
+    if (button > 2 && state != LANGUAGE_MENU) {
+        return 0;
+    }
+
+    return button;
+
+}
+
+//---------------------------------------------------------------------
+// Direction asked for with a pair of keys: -1 up, 1 down or 0
+//---------------------------------------------------------------------
+int keyDirection(int keys_held, int up_key, int down_key) {
+
+    if (keys_held & up_key) {
+        return -1;
+    } else if (keys_held & down_key) {
+        return 1;
+    }
 
     return 0;
 }
 
 //---------------------------------------------------------------------
-// Initializes the game
+// Darkens the game field while the match is paused
+//---------------------------------------------------------------------
+void showPaused(bool paused) {
+
+    setBrightness(1, paused ? -8 : 0);
+
+}
+
+//---------------------------------------------------------------------
+// Initializes the game field
 //---------------------------------------------------------------------
-int initGame(ball *b, paddle *p1, paddle *p2, u16* sprite_gfx_mem[]) {
+int initGameField() {
 
-    b->x = SCREEN_WIDTH / 2 - 1 - BALL_WIDTH / 2;
-    b->y = SCREEN_HEIGHT / 2 - 1 - BALL_HEIGHT / 2;
-    b->speed = INITIAL_SPEED;
-    b->angle = initial_angles[rand_lim(5)];
+    // set up the bitmap background of the main screen (game field)
+    int bg = bgInit(3, BgType_Bmp16, BgSize_B16_256x256, BITMAP_MAP_BASE,0);
+    assetLoad(ASSET_BACKGROUND, bgGetGfxPtr(bg));
 
-    p1->x = 8;
-    p1->y = SCREEN_HEIGHT / 2 - 1 - PADDLE_HEIGHT / 2;
-    p1->speed = PADDLE_INITIAL_SPEED;
-    p1->score = 0;
+    return 0;
+}
 
-    p2->x = SCREEN_WIDTH - PADDLE_WIDTH - 8;
-    p2->y = SCREEN_HEIGHT / 2 - 1 - PADDLE_HEIGHT / 2;
-    p2->speed = PADDLE_INITIAL_SPEED;
-    p2->score = 0;
+//---------------------------------------------------------------------
+// Sets the oam entries of the scores
+//---------------------------------------------------------------------
+void showScores(const game_state *gs, u16* sprite_gfx_mem[]) {
 
     // Set the oam entry for the score of the first player
     oamSet(&oamMain,                    // main graphics engine context
@@ -236,7 +225,7 @@ int initGame(ball *b, paddle *p1, paddle *p2, u16* sprite_gfx_mem[]) {
            0,                           // this is the palette index if multiple palettes or the alpha value if bmp sprite
            SpriteSize_32x32,
            SpriteColorFormat_256Color,
-           sprite_gfx_mem[p1->score],    // pointer to the loaded graphics
+           sprite_gfx_mem[gs->p1.score], // pointer to the loaded graphics
            -1,                          // sprite rotation data
            false,                       // double the size when rotating?
            false,                       // hide the sprite?
@@ -253,7 +242,7 @@ int initGame(ball *b, paddle *p1, paddle *p2, u16* sprite_gfx_mem[]) {
            0,                           // this is the palette index if multiple palettes or the alpha value if bmp sprite
            SpriteSize_32x32,
            SpriteColorFormat_256Color,
-           sprite_gfx_mem[p2->score],    // pointer to the loaded graphics
+           sprite_gfx_mem[gs->p2.score], // pointer to the loaded graphics
            -1,                          // sprite rotation data
            false,                       // double the size when rotating?
            false,                       // hide the sprite?
@@ -261,6 +250,102 @@ int initGame(ball *b, paddle *p1, paddle *p2, u16* sprite_gfx_mem[]) {
            false,                       // hflip
            false);                      // apply mosaic
 
+}
+
+//---------------------------------------------------------------------
+// Sets the oam entries of the ball and the paddles
+//---------------------------------------------------------------------
+void showBallAndPaddles(const game_state *gs, u16* gfx, u16* gfx_p1, u16* gfx_p2) {
+
+    // Set the oam entry for the ball
+    oamSet(&oamMain, //main graphics engine context
+        0,           //oam index (0 to 127)
+        (int) gs->b.x, (int) gs->b.y,   //x and y pixle location of the sprite
+        0,                    //priority, lower renders last (on top)
+        0,					  //this is the palette index if multiple palettes or the alpha value if bmp sprite
+        SpriteSize_8x8,
+        SpriteColorFormat_256Color,
+        gfx,                  //pointer to the loaded graphics
+        -1,                  //sprite rotation data
+        false,               //double the size when rotating?
+        false,			//hide the sprite?
+        false, false, //vflip, hflip
+        false	//apply mosaic
+        );
+
+    // Set the oam entry for the left paddle
+    oamSet(&oamMain, //main graphics engine context
+        1,           //oam index (0 to 127)
+        gs->p1.x, gs->p1.y,   //x and y pixle location of the sprite
+        0,                    //priority, lower renders last (on top)
+        0,					  //this is the palette index if multiple palettes or the alpha value if bmp sprite
+        SpriteSize_8x32,
+        SpriteColorFormat_256Color,
+        gfx_p1,                  //pointer to the loaded graphics
+        -1,                  //sprite rotation data
+        false,               //double the size when rotating?
+        false,			//hide the sprite?
+        false, false, //vflip, hflip
+        false	//apply mosaic
+        );
+
+    // Set the oam entry for the right paddle
+    oamSet(&oamMain, //main graphics engine context
+        2,           //oam index (0 to 127)
+        gs->p2.x, gs->p2.y,   //x and y pixle location of the sprite
+        0,                    //priority, lower renders last (on top)
+        0,					  //this is the palette index if multiple palettes or the alpha value if bmp sprite
+        SpriteSize_8x32,
+        SpriteColorFormat_256Color,
+        gfx_p2,                  //pointer to the loaded graphics
+        -1,                  //sprite rotation data
+        false,               //double the size when rotating?
+        false,			//hide the sprite?
+        false, false, //vflip, hflip
+        false	//apply mosaic
+        );
+
+}
+
+//---------------------------------------------------------------------
+// Initializes the game
+//---------------------------------------------------------------------
+int initGame(game_state *gs, u16* sprite_gfx_mem[]) {
+
+    gs->b.x = SCREEN_WIDTH / 2 - 1 - BALL_WIDTH / 2;
+    gs->b.y = SCREEN_HEIGHT / 2 - 1 - BALL_HEIGHT / 2;
+    gs->b.speed = INITIAL_SPEED;
+    gs->b.angle = initial_angles[rand_lim(5)];
+
+    telemetryRecord(TELEMETRY_SERVE, 0, 0, gs->b.angle);
+
+    gs->p1.x = 8;
+    gs->p1.y = SCREEN_HEIGHT / 2 - 1 - PADDLE_HEIGHT / 2;
+    gs->p1.speed = PADDLE_INITIAL_SPEED;
+    gs->p1.height = PADDLE_HEIGHT;
+    gs->p1.width = PADDLE_WIDTH;
+    gs->p1.score = 0;
+
+    gs->p2.x = SCREEN_WIDTH - PADDLE_WIDTH - 8;
+    gs->p2.y = SCREEN_HEIGHT / 2 - 1 - PADDLE_HEIGHT / 2;
+    gs->p2.speed = PADDLE_INITIAL_SPEED;
+    gs->p2.height = PADDLE_HEIGHT;
+    gs->p2.width = PADDLE_WIDTH;
+    gs->p2.score = 0;
+
+    paddleControlReset(&gs->p1, 0);
+    paddleControlReset(&gs->p2, 1);
+
+    // Put back all the blocks (or none if the obstacle mode is off)
+    obstaclesReset(&gs->grid, gs->obstacles_enabled);
+
+    // Nothing to rewind in a new match
+    snapshotRingClear();
+
+    rewinding = false;
+
+    showScores(gs, sprite_gfx_mem);
+
     return 0;
 }
 
@@ -274,30 +359,64 @@ int main(void) {
 
     int keys_pressed, keys_held, keys_released;
 
-    unsigned int language;
+    // The ball, the paddles, the blocks, the menu and the language
+    game_state gs;
+
+    bool paused = false;
+
+    // Control scheme of the first player, changed with Y in the main menu
+    int control_scheme = CONTROL_DIGITAL;
+
+    // Menu button tapped this frame (see touchButton) and, when the stylus
+    // moves the paddle, the button it went down on, pressed on release
+    int button, touch_button = 0;
 
-    unsigned int state;
+    int obstacle_hit;
 
-    bool game_ended = false;
+    // True while the frame only waits for the vertical blank
+    bool idle;
 
-    // Ball
-    ball b;
+    bool first_frame = true;
 
-    // Left paddle
-    paddle p1;
+    // Bus clock ticks of the work of a frame, before and after the vertical blank
+    u32 work_ticks, post_vblank_ticks;
 
-    // Rigth paddle
-    paddle p2;
+    // The game state saved when the match is paused
+    game_state paused_gs;
 
-    state = LANGUAGE_MENU;
-    language = EN;
+    // The blocks on screen before rewinding a frame
+    obstacle_grid shown_grid;
+
+    gs.state = LANGUAGE_MENU;
+    gs.language = EN;
+    gs.game_ended = false;
+
+    // Obstacle mode, chosen by holding L or R while tapping a game mode
+    gs.obstacles_enabled = false;
+
+#ifdef BENCHMARK
+    // Benchmark build: run the benchmarks instead of the game
+    runBenchmarks();
+#endif
+
+    // Measure the time from here to the first frame
+    cpuStartTiming(TELEMETRY_TIMER);
 
     initScreensAndVRAM();
 
+    // Mount the SD card to save the telemetry of the matches
+    telemetryInit();
+
+    // Sleep when the lid is closed
+    powerInit();
+
+    // The (hidden) tile layer of the obstacle mode
+    obstaclesInit();
+
     showSplash();
 
     // Show the language menu
-    showMenu(state, language);
+    showMenu(gs.state, gs.language);
 
     // Initialize the 2D sprite engine of the main (top) screen
 	oamInit(&oamMain, SpriteMapping_1D_128, false);
@@ -331,6 +450,10 @@ int main(void) {
     mmLoadEffect(SFX_TXALAPARTA3);
     mmLoadEffect(SFX_TXALAPARTA4);
 
+    // Stream the music of the menus from the ROM filesystem
+    musicInit();
+    musicPlay(MUSIC_MENU);
+
 	mm_sound_effect txalaparta1 = {
 		{ SFX_TXALAPARTA1 },	// id
 		(int)(1.0f * (1<<10)),	// rate
@@ -365,158 +488,376 @@ int main(void) {
 
 	while(1) {
 
-		scanKeys();
+        if (first_frame) {
+            traceBoot(cpuGetTiming());
+            first_frame = false;
+        }
+
+        // Measure how long the work of this frame takes
+        cpuStartTiming(TELEMETRY_TIMER);
 
-        keys_pressed = keysDown();
-        keys_held = keysHeld();
-        keys_released = keysUp();
+        // The keys come from a script in the emulator performance test
+		inputScan();
+
+        keys_pressed = inputDown();
+        keys_held = inputHeld();
+        keys_released = inputUp();
 
         touchPosition touch;
 
+        inputTouch(&touch);
+
+        idle = true;
+
+        // The lid was closed: pause the match and sleep until it is opened
+        if (keys_pressed & KEY_LID) {
+
+            if (paused == false && gs.game_ended == false && (gs.state == ONE_PLAYER_GAME || gs.state == TWO_PLAYERS_GAME)) {
+
+                snapshotTake(&paused_gs, &gs);
+
+                paused = true;
+
+                showPaused(paused);
+
+            }
+
+            powerSleep();
+
+        }
+
+        // Pause or resume the match
+        if ((keys_pressed & KEY_START) && gs.game_ended == false && (gs.state == ONE_PLAYER_GAME || gs.state == TWO_PLAYERS_GAME)) {
+
+            if (paused) {
+
+                // Resume exactly where the match was paused
+                snapshotRestore(&gs, &paused_gs);
+
+            } else {
+
+                snapshotTake(&paused_gs, &gs);
+
+            }
+
+            paused = !paused;
+
+            showPaused(paused);
+
+            idle = false;
+
+        }
+
+        // Save the paused match on the SD card
+        if ((keys_pressed & KEY_SELECT) && paused && (gs.state == ONE_PLAYER_GAME || gs.state == TWO_PLAYERS_GAME)) {
+
+            if (snapshotSave(&gs)) {
+                mmEffectEx(&txalaparta1);
+            }
+
+        }
+
+        // Load the saved match from the main menu, it starts paused
+        if ((keys_pressed & KEY_SELECT) && gs.state == MAIN_MENU && snapshotLoad(&gs)) {
+
+            initGameField();
+
+            musicPlay(MUSIC_MATCH);
+
+            telemetryStartMatch(gs.state);
+
+            obstaclesShow(&gs.grid, gs.obstacles_enabled);
+
+            snapshotRingClear();
+            rewinding = false;
+
+            showScores(&gs, sprite_gfx_mem);
+            showBallAndPaddles(&gs, gfx, gfx_p1, gfx_p2);
+
+            snapshotTake(&paused_gs, &gs);
+
+            paused = true;
+
+            showPaused(paused);
+
+            showMenu(gs.state, gs.language);
+
+            idle = false;
+
+        }
+
+        // Change the control scheme, a different sound for each one
+        if ((keys_pressed & KEY_Y) && gs.state == MAIN_MENU) {
+
+            control_scheme = (control_scheme + 1) % CONTROL_SCHEME_COUNT;
+
+            if (control_scheme == CONTROL_DIGITAL) {
+                mmEffectEx(&txalaparta1);
+            } else if (control_scheme == CONTROL_ACCEL) {
+                mmEffectEx(&txalaparta2);
+            } else {
+                mmEffectEx(&txalaparta3);
+            }
+
+        }
+
+        if ((keys_pressed & KEY_L) && paused == false && (gs.state == ONE_PLAYER_GAME || gs.state == TWO_PLAYERS_GAME)) {
+            rewinding = true;
+        } else if (!(keys_held & KEY_L)) {
+            rewinding = false;
+        }
+
+        // With the touch control the stylus moves the paddle over the buttons
+        // of the match: they are only pressed if it goes up without leaving them
+        button = 0;
+
+        if (control_scheme == CONTROL_TOUCH && (gs.state == ONE_PLAYER_GAME || gs.state == TWO_PLAYERS_GAME)) {
+
+            if (keys_pressed & KEY_TOUCH) {
+                touch_button = touchButton(&touch, gs.state);
+            } else if ((keys_held & KEY_TOUCH) && touchButton(&touch, gs.state) != touch_button) {
+                touch_button = 0;
+            }
+
+            if (keys_released & KEY_TOUCH) {
+                button = touch_button;
+                touch_button = 0;
+            }
+
+        } else {
+
+            touch_button = 0;
+
+            if (keys_pressed & KEY_TOUCH) {
+                button = touchButton(&touch, gs.state);
+            }
+
+        }
+
         // The user tapped on a menu option
-        if(keys_pressed & KEY_TOUCH) {
+        if (button != 0) {
 
-            touchRead(&touch);
+            idle = false;
 
             // The user pressed the first button
-            if (touch.px >= 52 && touch.px <= 211 && touch.py >= 53 && touch.py <= 73) {
+            if (button == 1) {
 
                 // English button pressed in the language menu
-                if (state == LANGUAGE_MENU) {
+                if (gs.state == LANGUAGE_MENU) {
 
-                    language = EN;
-                    state = MAIN_MENU;
+                    gs.language = EN;
+                    gs.state = MAIN_MENU;
 
-                    showMenu(state, language);
+                    showMenu(gs.state, gs.language);
 
                 // 1 player mode button pressed in the main menu
-                } else if (state == MAIN_MENU) {
+                } else if (gs.state == MAIN_MENU) {
+
+                    gs.state = ONE_PLAYER_GAME;
 
-                    state = ONE_PLAYER_GAME;
+                    gs.obstacles_enabled = (keys_held & (KEY_L | KEY_R)) != 0;
 
                     initGameField();
 
-                    initGame(&b, &p1, &p2, sprite_gfx_mem);
+                    musicPlay(MUSIC_MATCH);
+
+                    telemetryStartMatch(gs.state);
+
+                    initGame(&gs, sprite_gfx_mem);
 
-                    game_ended = false;
+                    gs.game_ended = false;
 
-                    showMenu(state, language);
+                    paused = false;
+
+                    showPaused(paused);
+
+                    showMenu(gs.state, gs.language);
 
                 // Restart button pressed (1 player mode)
-                } else if (state == ONE_PLAYER_GAME) {
+                } else if (gs.state == ONE_PLAYER_GAME) {
+
+                    telemetryFlush(gs.p1.score, gs.p2.score);
+                    telemetryStartMatch(gs.state);
+
+                    initGame(&gs, sprite_gfx_mem);
 
-                    initGame(&b, &p1, &p2, sprite_gfx_mem);
+                    gs.game_ended = false;
 
-                    game_ended = false;
+                    paused = false;
+
+                    showPaused(paused);
 
                 // Restart button pressed (2 players mode)
-                } else if (state == TWO_PLAYERS_GAME) {
+                } else if (gs.state == TWO_PLAYERS_GAME) {
+
+                    telemetryFlush(gs.p1.score, gs.p2.score);
+                    telemetryStartMatch(gs.state);
+
+                    initGame(&gs, sprite_gfx_mem);
 
-                    initGame(&b, &p1, &p2, sprite_gfx_mem);
+                    gs.game_ended = false;
 
-                    game_ended = false;
+                    paused = false;
+
+                    showPaused(paused);
 
                 }
 
             // The user pressed the second button
-            } else if (touch.px >= 52 && touch.px <= 211 && touch.py >= 77 && touch.py <= 97) {
+            } else if (button == 2) {
 
                 // Basque button pressed in the language menu
-                if (state == LANGUAGE_MENU) {
+                if (gs.state == LANGUAGE_MENU) {
 
-                    language = EU;
-                    state = MAIN_MENU;
+                    gs.language = EU;
+                    gs.state = MAIN_MENU;
 
-                    showMenu(state, language);
+                    showMenu(gs.state, gs.language);
 
 
                 // 2 players mode button pressed in the main menu
-                } else if (state == MAIN_MENU) {
+                } else if (gs.state == MAIN_MENU) {
+
+                    gs.state = TWO_PLAYERS_GAME;
 
-                    state = TWO_PLAYERS_GAME;
+                    gs.obstacles_enabled = (keys_held & (KEY_L | KEY_R)) != 0;
 
                     initGameField();
 
-                    initGame(&b, &p1, &p2, sprite_gfx_mem);
+                    musicPlay(MUSIC_MATCH);
+
+                    telemetryStartMatch(gs.state);
+
+                    initGame(&gs, sprite_gfx_mem);
 
-                    game_ended = false;
+                    gs.game_ended = false;
 
-                    showMenu(state, language);
+                    paused = false;
+
+                    showPaused(paused);
+
+                    showMenu(gs.state, gs.language);
 
                 // Back to main menu button pressed (1 player mode)
-                } else if (state == ONE_PLAYER_GAME) {
+                } else if (gs.state == ONE_PLAYER_GAME) {
 
-                    state = MAIN_MENU;
+                    // Save the telemetry of the unfinished match
+                    telemetryFlush(gs.p1.score, gs.p2.score);
+
+                    gs.state = MAIN_MENU;
 
                     // Clear all the sprites of the game
                     oamClear(&oamMain, 0, 128);
 
+                    // And the blocks of the obstacle mode
+                    obstaclesReset(&gs.grid, false);
+
+                    paused = false;
+
+                    showPaused(paused);
+
+                    musicPlay(MUSIC_MENU);
+
                     showSplash();
 
                     // Display the main menu
-                    showMenu(state, language);
+                    showMenu(gs.state, gs.language);
 
                 // Back to main menu button pressed (2 players mode)
-                } else if (state == TWO_PLAYERS_GAME) {
+                } else if (gs.state == TWO_PLAYERS_GAME) {
+
+                    // Save the telemetry of the unfinished match
+                    telemetryFlush(gs.p1.score, gs.p2.score);
 
-                    state = MAIN_MENU;
+                    gs.state = MAIN_MENU;
 
                     // Clear all the sprites of the game
                     oamClear(&oamMain, 0, 128);
 
+                    // And the blocks of the obstacle mode
+                    obstaclesReset(&gs.grid, false);
+
+                    paused = false;
+
+                    showPaused(paused);
+
+                    musicPlay(MUSIC_MENU);
+
                     showSplash();
 
                     // Display the main menu
-                    showMenu(state, language);
+                    showMenu(gs.state, gs.language);
 
                 }
 
             // The user tapped the third button
-            } else if (touch.px >= 52 && touch.px <= 211 && touch.py >= 103 && touch.py <= 123) {
+            } else if (button == 3) {
 
                 // Spanish button pressed in the language menu
-                if (state == LANGUAGE_MENU) {
+                if (gs.state == LANGUAGE_MENU) {
 
-                    language = ES;
-                    state = MAIN_MENU;
+                    gs.language = ES;
+                    gs.state = MAIN_MENU;
 
-                    showMenu(state, language);
+                    showMenu(gs.state, gs.language);
 
                 }
 
             // The user pressed the fourth button
-            } else if (touch.px >= 52 && touch.px <= 211 && touch.py >= 128 && touch.py <= 148) {
+            } else if (button == 4) {
 
                 // French button pressed in the language menu
-                if (state == LANGUAGE_MENU) {
+                if (gs.state == LANGUAGE_MENU) {
 
-                    language = FR;
-                    state = MAIN_MENU;
+                    gs.language = FR;
+                    gs.state = MAIN_MENU;
 
-                    showMenu(state, language);
+                    showMenu(gs.state, gs.language);
 
                 }
 
             }
 
-        } else if (game_ended == false && (state == ONE_PLAYER_GAME || state == TWO_PLAYERS_GAME)) {
+        // Rewind the match one frame per frame while L is held
+        } else if (rewinding && gs.game_ended == false && paused == false && (gs.state == ONE_PLAYER_GAME || gs.state == TWO_PLAYERS_GAME)) {
+
+            idle = false;
+
+            shown_grid = gs.grid;
+
+            if (snapshotRewind(&gs)) {
+
+                // Put back the blocks destroyed since then
+                obstaclesSync(&shown_grid, &gs.grid);
+
+                showScores(&gs, sprite_gfx_mem);
+                showBallAndPaddles(&gs, gfx, gfx_p1, gfx_p2);
+
+            }
+
+        } else if (gs.game_ended == false && paused == false && (gs.state == ONE_PLAYER_GAME || gs.state == TWO_PLAYERS_GAME)) {
+
+            idle = false;
+
+            // Keep the last frames to rewind them
+            snapshotPush(&gs);
 
             // One player mode (VS CPU)
-            if (state == ONE_PLAYER_GAME) {
+            if (gs.state == ONE_PLAYER_GAME) {
 
                 // Artificial intelligence for the paddle controlled by the CPU (only in one player mode)
 
                 // If the ball is moving towards the paddle controlled by the CPU
-                if (b.speed * cos(b.angle * DEGREE_TO_RADIAN) > 0) {
+                if (gs.b.speed * cos(gs.b.angle * DEGREE_TO_RADIAN) > 0) {
 
                     // If the ball is above the paddle
-                    if (b.y < p2.y) {
+                    if (gs.b.y < gs.p2.y) {
 
                         // Don't let the paddle move above the top of the screen
-                        if (p2.y > 0) {
+                        if (gs.p2.y > 0) {
 
                             // Move the paddle up
-                            p2.y = p2.y - p2.speed;
+                            gs.p2.y = gs.p2.y - gs.p2.speed;
 
                         }
 
@@ -524,10 +865,10 @@ int main(void) {
                     } else {
 
                         // Don't let the paddle move below the bottom of the screen
-                        if (p2.y < SCREEN_HEIGHT - PADDLE_HEIGHT) {
+                        if (gs.p2.y < SCREEN_HEIGHT - PADDLE_HEIGHT) {
 
                             // Move the paddle down
-                            p2.y = p2.y + p2.speed;
+                            gs.p2.y = gs.p2.y + gs.p2.speed;
 
                         }
 
@@ -537,95 +878,36 @@ int main(void) {
                 } else {
 
                     // If the paddle controlled by the CPU is above the center of the screen
-                    if (p2.y > SCREEN_HEIGHT / 2 - 1 - PADDLE_HEIGHT / 2) {
+                    if (gs.p2.y > SCREEN_HEIGHT / 2 - 1 - PADDLE_HEIGHT / 2) {
 
                         // Move the paddle controlled byt the CPU down
-                        p2.y = p2.y - p2.speed;
+                        gs.p2.y = gs.p2.y - gs.p2.speed;
 
                     // If the paddle controlled by the CPU is below the center of the screen
                     } else {
 
                         // Move the paddle controlled by the CPU up
-                        p2.y = p2.y + p2.speed;
+                        gs.p2.y = gs.p2.y + gs.p2.speed;
 
                     }
                 }
 
-                // If the player is holding the up button
-                if (keys_held & KEY_UP) {
-
-                    // Don't let the paddle move above the top of the screen
-                    if (p1.y > 0) {
-
-                        // Move the right paddle up
-                        p1.y = p1.y - p1.speed;
-
-                    }
-
-                // Else if the player is holding the down button
-                } else if (keys_held & KEY_DOWN) {
-
-                    // Don't let the paddle move below the bottom of the screen
-                    if (p1.y < SCREEN_HEIGHT - PADDLE_HEIGHT) {
-
-                        // Move the right paddle down
-                        p1.y = p1.y + p1.speed;
-
-                    }
-
-                }
+                // The CPU moves whole pixels
+                gs.p2.fy = inttof32(gs.p2.y);
 
             // Two players mode
             } else {
 
-                // If the first player is holding the up button
-                if (keys_held & KEY_UP) {
-
-                    // Don't let the paddle move above the top of the screen
-                    if (p1.y > 0) {
-
-                        // Move the right paddle up
-                        p1.y = p1.y - p1.speed;
-
-                    }
-
-                // Else if the first player is holding the down button
-                } else if (keys_held & KEY_DOWN) {
-
-                    // Don't let the paddle move below the bottom of the screen
-                    if (p1.y < SCREEN_HEIGHT - PADDLE_HEIGHT) {
-
-                        // Move the right paddle down
-                        p1.y = p1.y + p1.speed;
-
-                    }
-
-                }
-
-                // If the second player is holding the X button
-                if (keys_held & KEY_X) {
-
-                    // Don't let the paddle move above the top of the screen
-                    if (p2.y > 0) {
-
-                        p2.y = p2.y - p2.speed;
-
-                    }
-
-                // Else if the second player is holding the B button
-                } else if (keys_held & KEY_B) {
-
-                    // Don't let the paddle move below the bottom of the screen
-                    if (p2.y < SCREEN_HEIGHT - PADDLE_HEIGHT) {
-
-                        p2.y = p2.y + p2.speed;
-
-                    }
-
-                }
+                // The second player uses the X and B buttons (the stylus is for the first player)
+                paddleControlUpdate(&gs.p2, 1, control_scheme == CONTROL_ACCEL ? CONTROL_ACCEL : CONTROL_DIGITAL,
+                                    keyDirection(keys_held, KEY_X, KEY_B), PADDLE_NO_TOUCH);
 
             }
 
+            // The first player uses the up and down buttons or the stylus
+            paddleControlUpdate(&gs.p1, 0, control_scheme, keyDirection(keys_held, KEY_UP, KEY_DOWN),
+                                (keys_held & KEY_TOUCH) ? touch.py : PADDLE_NO_TOUCH);
+
             /*
              *         270
              *          |
@@ -640,56 +922,86 @@ int main(void) {
              */
 
             // Bottom of the screen
-            if (b.y + b.speed * sin(b.angle * DEGREE_TO_RADIAN) >= SCREEN_HEIGHT - 1 - BALL_HEIGHT) {
+            if (gs.b.y + gs.b.speed * sin(gs.b.angle * DEGREE_TO_RADIAN) >= SCREEN_HEIGHT - 1 - BALL_HEIGHT) {
+
+                gs.b.angle = 180 - (gs.b.angle - 180);
 
-                b.angle = 180 - (b.angle - 180);
+                telemetryRecord(TELEMETRY_WALL_BOUNCE, 1, 0, gs.b.angle);
 
                 mmEffectEx(&txalaparta3);
 
             // Top of the screen
-            } else if (b.y + b.speed * sin(b.angle * DEGREE_TO_RADIAN) <= 0) {
+            } else if (gs.b.y + gs.b.speed * sin(gs.b.angle * DEGREE_TO_RADIAN) <= 0) {
 
                 // b.angle = 0 - (b.angle - 0)
-                b.angle = -b.angle;
+                gs.b.angle = -gs.b.angle;
+
+                telemetryRecord(TELEMETRY_WALL_BOUNCE, 0, 0, gs.b.angle);
 
                 mmEffectEx(&txalaparta4);
 
             // Left paddle collision detection
-            } else if (b.x <= p1.x + PADDLE_WIDTH && b.y > p1.y - BALL_HEIGHT && b.y < p1.y + PADDLE_HEIGHT + BALL_HEIGHT) {
+            } else if (gs.b.x <= gs.p1.x + PADDLE_WIDTH && gs.b.y > gs.p1.y - BALL_HEIGHT && gs.b.y < gs.p1.y + PADDLE_HEIGHT + BALL_HEIGHT) {
 
-                int hit_y = b.y - p1.y + BALL_HEIGHT;
+                int hit_y = gs.b.y - gs.p1.y + BALL_HEIGHT;
 
                 // The return angle is the specular image of the hit angle
                 // b.angle = 90 - (b.angle - 90);
 
                 // The return angle is going to be between 300 and 60 degrees depending on the hit position
-                b.angle = (int) 300 + (120 * hit_y / 48.0);
+                gs.b.angle = (int) 300 + (120 * hit_y / 48.0);
+
+                telemetryRecord(TELEMETRY_PADDLE_HIT, 1, hit_y, gs.b.angle);
 
                 // Increase the speed of the ball
-                b.speed = b.speed + 0.1;
+                gs.b.speed = gs.b.speed + 0.1;
 
                 mmEffectEx(&txalaparta1);
 
             // Right paddle collision detection
-            } else if (b.x >= p2.x - PADDLE_WIDTH && b.y > p2.y - BALL_HEIGHT && b.y < p2.y + PADDLE_HEIGHT + BALL_HEIGHT) {
+            } else if (gs.b.x >= gs.p2.x - PADDLE_WIDTH && gs.b.y > gs.p2.y - BALL_HEIGHT && gs.b.y < gs.p2.y + PADDLE_HEIGHT + BALL_HEIGHT) {
 
-                int hit_y = b.y - p2.y + BALL_HEIGHT;
+                int hit_y = gs.b.y - gs.p2.y + BALL_HEIGHT;
 
                 // The return angle is the specular image of the hit angle
                 //b.angle = 270 - (b.angle - 270);
 
                 // The return angle is going to be between 240 and 60 degrees depending on the hit position
-                b.angle = (int) 240 - (120 * hit_y / 48.0);
+                gs.b.angle = (int) 240 - (120 * hit_y / 48.0);
+
+                telemetryRecord(TELEMETRY_PADDLE_HIT, 2, hit_y, gs.b.angle);
 
                 // Increase the speed of the ball
-                b.speed = b.speed + 0.1;
+                gs.b.speed = gs.b.speed + 0.1;
 
                 mmEffectEx(&txalaparta2);
 
+            // Obstacle collision detection: a lookup into the grid of blocks at the next position of the ball
+            } else if (gs.obstacles_enabled && (obstacle_hit = obstaclesHit(&gs.grid, (int) gs.b.x, (int) gs.b.y,
+                                                                         (int) (gs.b.x + gs.b.speed * cos(gs.b.angle * DEGREE_TO_RADIAN)),
+                                                                         (int) (gs.b.y + gs.b.speed * sin(gs.b.angle * DEGREE_TO_RADIAN)),
+                                                                         BALL_WIDTH))) {
+
+                // Hit on the left or right side of a block
+                if (obstacle_hit & OBSTACLE_HIT_X) {
+                    gs.b.angle = 180 - gs.b.angle;
+                }
+
+                // Hit on the top or bottom side of a block
+                if (obstacle_hit & OBSTACLE_HIT_Y) {
+                    gs.b.angle = -gs.b.angle;
+                }
+
+                telemetryRecord(TELEMETRY_WALL_BOUNCE, 2, 0, gs.b.angle);
+
+                mmEffectEx(&txalaparta4);
+
             // Left border of the screen
-            } else if (b.x <= 0) {
+            } else if (gs.b.x <= 0) {
+
+                gs.p2.score = gs.p2.score + 1;
 
-                p2.score = p2.score + 1;
+                telemetryRecord(TELEMETRY_GOAL, 2, gs.p2.score, 0);
 
                 // Set the oam entry for the score of the second player
                 oamSet(&oamMain,                    // main graphics engine context
@@ -700,7 +1012,7 @@ int main(void) {
                         0,                           // this is the palette index if multiple palettes or the alpha value if bmp sprite
                         SpriteSize_32x32,
                         SpriteColorFormat_256Color,
-                        sprite_gfx_mem[p2.score],    // pointer to the loaded graphics
+                        sprite_gfx_mem[gs.p2.score],    // pointer to the loaded graphics
                         -1,                          // sprite rotation data
                         false,                       // double the size when rotating?
                         false,                       // hide the sprite?
@@ -708,28 +1020,34 @@ int main(void) {
                         false,                       // hflip
                         false);                      // apply mosaic
 
-                if (p2.score < SCORE_LIMIT) {
+                if (gs.p2.score < SCORE_LIMIT) {
+
+                    gs.b.x = SCREEN_WIDTH / 2 - 1 - BALL_WIDTH / 2;
+                    gs.b.y = SCREEN_HEIGHT / 2 - 1 - BALL_HEIGHT / 2;
 
-                    b.x = SCREEN_WIDTH / 2 - 1 - BALL_WIDTH / 2;
-                    b.y = SCREEN_HEIGHT / 2 - 1 - BALL_HEIGHT / 2;
+                    gs.b.angle = initial_angles[rand_lim(2) + 3]; // 300, 0, 60
 
-                    b.angle = initial_angles[rand_lim(2) + 3]; // 300, 0, 60
+                    telemetryRecord(TELEMETRY_SERVE, 2, 0, gs.b.angle);
 
-                    b.speed = INITIAL_SPEED;
+                    gs.b.speed = INITIAL_SPEED;
 
                 } else {
 
-                    game_ended = true;
+                    gs.game_ended = true;
 
                     // Hide the ball
                     oamClearSprite(&oamMain, 0);
 
+                    telemetryFlush(gs.p1.score, gs.p2.score);
+
                 }
 
             // Right border of the screen
-            } else if (b.x >= SCREEN_WIDTH - 1) {
+            } else if (gs.b.x >= SCREEN_WIDTH - 1) {
+
+                gs.p1.score = gs.p1.score + 1;
 
-                p1.score = p1.score + 1;
+                telemetryRecord(TELEMETRY_GOAL, 1, gs.p1.score, 0);
 
                 // Set the oam entry for the score of the first player
                 oamSet(&oamMain,                    // main graphics engine context
@@ -740,7 +1058,7 @@ int main(void) {
                         0,                           // this is the palette index if multiple palettes or the alpha value if bmp sprite
                         SpriteSize_32x32,
                         SpriteColorFormat_256Color,
-                        sprite_gfx_mem[p1.score],    // pointer to the loaded graphics
+                        sprite_gfx_mem[gs.p1.score],    // pointer to the loaded graphics
                         -1,                          // sprite rotation data
                         false,                       // double the size when rotating?
                         false,                       // hide the sprite?
@@ -748,88 +1066,68 @@ int main(void) {
                         false,                       // hflip
                         false);                      // apply mosaic
 
-                if (p1.score < SCORE_LIMIT) {
+                if (gs.p1.score < SCORE_LIMIT) {
 
-                    b.x = SCREEN_WIDTH / 2 - 1 - BALL_WIDTH / 2;
-                    b.y = SCREEN_HEIGHT / 2 - 1 - BALL_HEIGHT / 2;
+                    gs.b.x = SCREEN_WIDTH / 2 - 1 - BALL_WIDTH / 2;
+                    gs.b.y = SCREEN_HEIGHT / 2 - 1 - BALL_HEIGHT / 2;
 
-                    b.angle = initial_angles[rand_lim(2)]; // 120, 180, 240
-                    b.speed = INITIAL_SPEED;
+                    gs.b.angle = initial_angles[rand_lim(2)]; // 120, 180, 240
+
+                    telemetryRecord(TELEMETRY_SERVE, 1, 0, gs.b.angle);
+                    gs.b.speed = INITIAL_SPEED;
 
                 } else {
 
-                    game_ended = true;
+                    gs.game_ended = true;
 
                     // Hide the ball
                     oamClearSprite(&oamMain, 0);
 
+                    telemetryFlush(gs.p1.score, gs.p2.score);
+
                 }
 
             }
 
-            if (game_ended == false) {
+            if (gs.game_ended == false) {
 
                 // Update the position of the ball
-                b.x = b.x + b.speed * cos(b.angle * DEGREE_TO_RADIAN);
-                b.y = b.y + b.speed * sin(b.angle * DEGREE_TO_RADIAN);
-
-                // Set the oam entry for the ball
-                oamSet(&oamMain, //main graphics engine context
-                    0,           //oam index (0 to 127)
-                    (int) b.x, (int) b.y,   //x and y pixle location of the sprite
-                    0,                    //priority, lower renders last (on top)
-                    0,					  //this is the palette index if multiple palettes or the alpha value if bmp sprite
-                    SpriteSize_8x8,
-                    SpriteColorFormat_256Color,
-                    gfx,                  //pointer to the loaded graphics
-                    -1,                  //sprite rotation data
-                    false,               //double the size when rotating?
-                    false,			//hide the sprite?
-                    false, false, //vflip, hflip
-                    false	//apply mosaic
-                    );
-
-                // Set the oam entry for the left paddle
-                oamSet(&oamMain, //main graphics engine context
-                    1,           //oam index (0 to 127)
-                    p1.x, p1.y,   //x and y pixle location of the sprite
-                    0,                    //priority, lower renders last (on top)
-                    0,					  //this is the palette index if multiple palettes or the alpha value if bmp sprite
-                    SpriteSize_8x32,
-                    SpriteColorFormat_256Color,
-                    gfx_p1,                  //pointer to the loaded graphics
-                    -1,                  //sprite rotation data
-                    false,               //double the size when rotating?
-                    false,			//hide the sprite?
-                    false, false, //vflip, hflip
-                    false	//apply mosaic
-                    );
-
-                // Set the oam entry for the right paddle
-                oamSet(&oamMain, //main graphics engine context
-                    2,           //oam index (0 to 127)
-                    p2.x, p2.y,   //x and y pixle location of the sprite
-                    0,                    //priority, lower renders last (on top)
-                    0,					  //this is the palette index if multiple palettes or the alpha value if bmp sprite
-                    SpriteSize_8x32,
-                    SpriteColorFormat_256Color,
-                    gfx_p2,                  //pointer to the loaded graphics
-                    -1,                  //sprite rotation data
-                    false,               //double the size when rotating?
-                    false,			//hide the sprite?
-                    false, false, //vflip, hflip
-                    false	//apply mosaic
-                    );
+                gs.b.x = gs.b.x + gs.b.speed * cos(gs.b.angle * DEGREE_TO_RADIAN);
+                gs.b.y = gs.b.y + gs.b.speed * sin(gs.b.angle * DEGREE_TO_RADIAN);
+
+                showBallAndPaddles(&gs, gfx, gfx_p1, gfx_p2);
+
+                telemetryFrame();
 
             }
 
         }
 
+        powerFrame(idle);
+
+        work_ticks = cpuGetTiming();
+
         // Wait for a vertical blank interrupt
         swiWaitForVBlank();
 
-        // Update the oam memories of the main screen
-        oamUpdate(&oamMain);
+        // The work after the vertical blank is measured apart
+        cpuStartTiming(TELEMETRY_TIMER);
+
+        // Update the oam memories of the main screen (nothing changed in idle frames)
+        if (!idle) {
+            oamUpdate(&oamMain);
+        }
+
+        // Refill the music stream now that the work of the frame is done
+        musicUpdate();
+
+        post_vblank_ticks = cpuGetTiming();
+
+        traceFrame(work_ticks + post_vblank_ticks, post_vblank_ticks, gs.state, idle);
+
+        if (inputScriptEnded()) {
+            traceEnd();
+        }
 
 	}
 
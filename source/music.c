@@ -0,0 +1,227 @@
+/*---------------------------------------------------------------------------------
+
+PongDS - Simple Pong-like game for the Nintendo DS
+
+Author: Asier Iturralde Sarasola
+License: GPL v3
+
+---------------------------------------------------------------------------------*/
+
+#include <nds.h>
+#include <maxmod9.h>
+#include <filesystem.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "music.h"
+#include "music_format.h"
+#include "music_ring.h"
+
+// In the same order as enum music_tracks
+static const char *music_files[] = {
+    "nitro:/music/menu.pdsm",
+    "nitro:/music/match.pdsm"
+};
+
+static s8 music_ring[MUSIC_RING_SIZE];
+
+// Bytes written to the ring by the main loop and taken from it by Maxmod.
+// Each one is only modified by one side, the difference is the fill.
+static volatile u32 music_write = 0;
+static volatile u32 music_read = 0;
+
+static volatile u32 music_underruns = 0;
+static volatile u32 music_underrun_samples = 0;
+static volatile u32 music_min_fill = MUSIC_RING_SIZE;
+static u32 music_bytes_read = 0;
+
+static FILE *music_file = NULL;
+static music_header music_hdr;
+static u32 music_position = 0;     // next sample of the track to read
+static volatile bool music_ended = false;
+static bool music_fs_ok = false;
+static bool music_playing = false;
+static int music_track = -1;
+
+//---------------------------------------------------------------------
+// Called by Maxmod (in its timer interrupt) when it needs more samples.
+// Only copies from the ring, it never touches the filesystem.
+//---------------------------------------------------------------------
+static mm_word musicStreamCallback(mm_word length, mm_addr dest, mm_stream_formats format) {
+
+    u32 read = music_read;
+    u32 write = music_write;
+    u32 available = write - read;
+    u32 count = musicRingRead(music_ring, MUSIC_RING_SIZE, read, write, (s8 *) dest, length);
+
+    // Not enough samples: silence was played, count it (unless the track is over)
+    if (count < length && !music_ended) {
+        music_underruns++;
+        music_underrun_samples += length - count;
+    }
+
+    music_read = read + count;
+
+    if (available - count < music_min_fill) {
+        music_min_fill = available - count;
+    }
+
+    return length;
+}
+
+//---------------------------------------------------------------------
+// Reads up to max_bytes of the track into the free part of the ring
+//---------------------------------------------------------------------
+static void musicFill(u32 max_bytes) {
+
+    u32 free = MUSIC_RING_SIZE - (music_write - music_read);
+    u32 todo = free < max_bytes ? free : max_bytes;
+
+    while (todo > 0 && !music_ended) {
+
+        u32 index = music_write & (MUSIC_RING_SIZE - 1);
+        u32 position = music_position;
+        u32 chunk = musicRingChunk(MUSIC_RING_SIZE, music_write, todo, &music_position,
+                                   music_hdr.sample_count, music_hdr.loop_start);
+        u32 got;
+
+        // End of the track: stop reading, or go back to the loop point
+        if (chunk == 0) {
+            music_ended = true;
+            break;
+        }
+
+        if (music_position != position) {
+            fseek(music_file, MUSIC_HEADER_SIZE + music_position, SEEK_SET);
+        }
+
+        got = fread(&music_ring[index], 1, chunk, music_file);
+
+        if (got == 0) {
+            music_ended = true;
+            break;
+        }
+
+        music_write += got;
+        music_position += got;
+        music_bytes_read += got;
+        todo -= got;
+    }
+
+}
+
+//---------------------------------------------------------------------
+// Mounts the ROM filesystem. Without it there is no music.
+//---------------------------------------------------------------------
+bool musicInit(void) {
+
+    music_fs_ok = nitroFSInit(NULL);
+
+    return music_fs_ok;
+}
+
+//---------------------------------------------------------------------
+// Starts streaming a track (if it is not already playing)
+//---------------------------------------------------------------------
+void musicPlay(int track) {
+
+    mm_stream stream;
+
+    if (track == music_track && music_playing) {
+        return;
+    }
+
+    musicStop();
+
+    music_track = track;
+
+    if (!music_fs_ok) {
+        return;
+    }
+
+    music_file = fopen(music_files[track], "rb");
+
+    if (music_file == NULL) {
+        return;
+    }
+
+    if (fread(&music_hdr, MUSIC_HEADER_SIZE, 1, music_file) != 1 || !musicHeaderValid(&music_hdr)) {
+
+        fclose(music_file);
+        music_file = NULL;
+        return;
+    }
+
+    music_write = 0;
+    music_read = 0;
+    music_position = 0;
+    music_ended = false;
+    music_min_fill = MUSIC_RING_SIZE;
+
+    // Fill the whole ring before Maxmod starts asking for samples
+    musicFill(MUSIC_RING_SIZE);
+
+    stream.sampling_rate = music_hdr.sample_rate;
+    stream.buffer_length = MUSIC_STREAM_BUFFER;
+    stream.callback = musicStreamCallback;
+    stream.format = MM_STREAM_8BIT_MONO;
+    stream.timer = MUSIC_TIMER;
+    stream.manual = false;
+
+    mmStreamOpen(&stream);
+
+    music_playing = true;
+
+}
+
+//---------------------------------------------------------------------
+// Stops the current track
+//---------------------------------------------------------------------
+void musicStop(void) {
+
+    if (music_playing) {
+        mmStreamClose();
+        music_playing = false;
+    }
+
+    if (music_file != NULL) {
+        fclose(music_file);
+        music_file = NULL;
+    }
+
+}
+
+//---------------------------------------------------------------------
+// Tops up the ring, reading at most MUSIC_REFILL_CHUNK bytes. Called
+// once per frame from the main loop, after the vertical blank.
+//---------------------------------------------------------------------
+void musicUpdate(void) {
+
+    if (music_playing) {
+        musicFill(MUSIC_REFILL_CHUNK);
+    }
+
+}
+
+//---------------------------------------------------------------------
+// Returns the underrun counters and the fill of the ring
+//---------------------------------------------------------------------
+void musicGetStats(music_stats *stats) {
+
+    stats->playing = music_playing;
+    stats->underruns = music_underruns;
+    stats->underrun_samples = music_underrun_samples;
+    stats->fill = music_write - music_read;
+    stats->min_fill = music_min_fill;
+    stats->bytes_read = music_bytes_read;
+
+}
+
+//---------------------------------------------------------------------
+// Starts a new measurement of the lowest fill of the ring
+//---------------------------------------------------------------------
+void musicResetMinFill(void) {
+
+    music_min_fill = music_write - music_read;
+
+}
@@ -0,0 +1,288 @@
+/*---------------------------------------------------------------------------------
+
+PongDS - Simple Pong-like game for the Nintendo DS
+
+Author: Asier Iturralde Sarasola
+License: GPL v3
+
+---------------------------------------------------------------------------------*/
+
+#include <nds.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "obstacles.h"
+
+// Tiles of the layer: 0 is empty (transparent), 1 is a block
+#define TILE_EMPTY 0
+#define TILE_BLOCK 1
+
+// Colors of the block in the background palette
+#define COLOR_BLOCK 1
+#define COLOR_BORDER 2
+
+// log2(OBSTACLE_TILE_SIZE), pixels to tiles
+#define TILE_SHIFT 3
+
+// Two walls of blocks, columns 6-10 and 21-25, leaving the serve area free
+#define WALL_COLUMNS 0x03E007C0
+
+// Columns where obstaclesFill() can put blocks (the paddles move outside)
+#define FIRST_COLUMN 2
+#define LAST_COLUMN 29
+
+static u16 *obstacle_map = NULL;
+static int obstacle_bg = -1;
+
+//---------------------------------------------------------------------
+// Sets up the tile layer of the blocks and hides it
+//---------------------------------------------------------------------
+void obstaclesInit(void) {
+
+    u8 block[OBSTACLE_TILE_SIZE * OBSTACLE_TILE_SIZE];
+    int x, y;
+
+    obstacle_bg = bgInit(OBSTACLE_BG_LAYER, BgType_Text8bpp, BgSize_T_256x256, OBSTACLE_MAP_BASE, OBSTACLE_TILE_BASE);
+    obstacle_map = bgGetMapPtr(obstacle_bg);
+
+    // A block is a filled tile with a darker border
+    for (y = 0; y < OBSTACLE_TILE_SIZE; y++) {
+        for (x = 0; x < OBSTACLE_TILE_SIZE; x++) {
+            block[y * OBSTACLE_TILE_SIZE + x] = (x == 0 || y == 0 || x == OBSTACLE_TILE_SIZE - 1 || y == OBSTACLE_TILE_SIZE - 1) ? COLOR_BORDER : COLOR_BLOCK;
+        }
+    }
+
+    dmaFillWords(0, bgGetGfxPtr(obstacle_bg), sizeof(block));
+    dmaCopy(block, (u8 *) bgGetGfxPtr(obstacle_bg) + TILE_BLOCK * sizeof(block), sizeof(block));
+
+    BG_PALETTE[COLOR_BLOCK] = RGB15(31,31,31);    // White
+    BG_PALETTE[COLOR_BORDER] = RGB15(16,16,16);   // Grey
+
+    dmaFillHalfWords(TILE_EMPTY, obstacle_map, 32 * 32 * 2);
+
+    bgHide(obstacle_bg);
+
+}
+
+//---------------------------------------------------------------------
+// Starts a match with the default wall of blocks, or with no blocks
+// (and the layer hidden) if the obstacle mode is not enabled
+//---------------------------------------------------------------------
+void obstaclesReset(obstacle_grid *grid, bool enabled) {
+
+    int y;
+
+    memset(grid, 0, sizeof(*grid));
+
+    if (enabled) {
+
+        for (y = 0; y < OBSTACLE_ROWS; y++) {
+            grid->rows[y] = WALL_COLUMNS;
+            grid->count += __builtin_popcount(WALL_COLUMNS);
+        }
+
+    }
+
+    obstaclesShow(grid, enabled);
+
+}
+
+//---------------------------------------------------------------------
+// Draws a grid (a new one or a restored one) and shows or hides the layer
+//---------------------------------------------------------------------
+void obstaclesShow(const obstacle_grid *grid, bool enabled) {
+
+    obstaclesDraw(grid);
+
+    if (obstacle_bg >= 0) {
+        if (enabled) {
+            bgShow(obstacle_bg);
+        } else {
+            bgHide(obstacle_bg);
+        }
+    }
+
+}
+
+//---------------------------------------------------------------------
+// Fills the grid with count blocks at random positions (benchmarks)
+//---------------------------------------------------------------------
+void obstaclesFill(obstacle_grid *grid, int count) {
+
+    int max = (LAST_COLUMN - FIRST_COLUMN + 1) * OBSTACLE_ROWS;
+
+    memset(grid, 0, sizeof(*grid));
+
+    if (count > max) {
+        count = max;
+    }
+
+    while ((int) grid->count < count) {
+
+        int x = FIRST_COLUMN + rand() % (LAST_COLUMN - FIRST_COLUMN + 1);
+        int y = rand() % OBSTACLE_ROWS;
+
+        if (!(grid->rows[y] & BIT(x))) {
+            grid->rows[y] |= BIT(x);
+            grid->count++;
+        }
+    }
+
+}
+
+//---------------------------------------------------------------------
+// Writes the whole grid to the map of the layer
+//---------------------------------------------------------------------
+void obstaclesDraw(const obstacle_grid *grid) {
+
+    int x, y;
+
+    if (obstacle_map == NULL) {
+        return;
+    }
+
+    for (y = 0; y < OBSTACLE_ROWS; y++) {
+        for (x = 0; x < OBSTACLE_COLUMNS; x++) {
+            obstacle_map[y * 32 + x] = (grid->rows[y] & BIT(x)) ? TILE_BLOCK : TILE_EMPTY;
+        }
+    }
+
+}
+
+//---------------------------------------------------------------------
+// Redraws the rows of the map that differ between the grid on screen
+// and the one that replaces it (rewinding puts back a few blocks)
+//---------------------------------------------------------------------
+void obstaclesSync(const obstacle_grid *from, const obstacle_grid *to) {
+
+    int x, y;
+
+    if (obstacle_map == NULL) {
+        return;
+    }
+
+    for (y = 0; y < OBSTACLE_ROWS; y++) {
+
+        if (from->rows[y] == to->rows[y]) {
+            continue;
+        }
+
+        for (x = 0; x < OBSTACLE_COLUMNS; x++) {
+            obstacle_map[y * 32 + x] = (to->rows[y] & BIT(x)) ? TILE_BLOCK : TILE_EMPTY;
+        }
+    }
+
+}
+
+//---------------------------------------------------------------------
+// Removes the block of the tile (x, y): one bit and one map entry
+//---------------------------------------------------------------------
+void obstacleDestroy(obstacle_grid *grid, int x, int y) {
+
+    if (grid->rows[y] & BIT(x)) {
+
+        grid->rows[y] &= ~BIT(x);
+        grid->count--;
+
+        if (obstacle_map != NULL) {
+            obstacle_map[y * 32 + x] = TILE_EMPTY;
+        }
+    }
+
+}
+
+//---------------------------------------------------------------------
+// Mask of the columns x0 and x1 of a row, if they are inside the grid
+//---------------------------------------------------------------------
+static inline u32 overlapMask(int x0, int x1) {
+
+    u32 mask = 0;
+
+    if (x0 >= 0 && x0 < OBSTACLE_COLUMNS) {
+        mask |= BIT(x0);
+    }
+
+    if (x1 >= 0 && x1 < OBSTACLE_COLUMNS) {
+        mask |= BIT(x1);
+    }
+
+    return mask;
+}
+
+static inline u32 rowAt(const obstacle_grid *grid, int y) {
+
+    return (y >= 0 && y < OBSTACLE_ROWS) ? grid->rows[y] : 0;
+
+}
+
+//---------------------------------------------------------------------
+// True if a size x size box at pixel (x, y) overlaps a block. The box
+// covers at most 2x2 tiles: two rows of the grid and a mask.
+//---------------------------------------------------------------------
+static bool overlaps(const obstacle_grid *grid, int x, int y, int size) {
+
+    // The shift rounds negative coordinates down, so they fall outside the grid
+    u32 mask = overlapMask(x >> TILE_SHIFT, (x + size - 1) >> TILE_SHIFT);
+
+    return ((rowAt(grid, y >> TILE_SHIFT) | rowAt(grid, (y + size - 1) >> TILE_SHIFT)) & mask) != 0;
+}
+
+//---------------------------------------------------------------------
+// Destroys the blocks that a size x size box at pixel (x, y) overlaps
+//---------------------------------------------------------------------
+static void destroyOverlapped(obstacle_grid *grid, int x, int y, int size) {
+
+    int tx0 = x >> TILE_SHIFT, tx1 = (x + size - 1) >> TILE_SHIFT;
+    int ty0 = y >> TILE_SHIFT, ty1 = (y + size - 1) >> TILE_SHIFT;
+    u32 mask = overlapMask(tx0, tx1);
+    int ty, tx;
+
+    for (ty = ty0; ty <= ty1; ty++) {
+
+        if (!(rowAt(grid, ty) & mask)) {
+            continue;
+        }
+
+        for (tx = tx0; tx <= tx1; tx++) {
+            if (tx >= 0 && tx < OBSTACLE_COLUMNS && (mask & BIT(tx))) {
+                obstacleDestroy(grid, tx, ty);
+            }
+        }
+    }
+
+}
+
+//---------------------------------------------------------------------
+// Checks if the ball (a size x size box, size <= 8) moving from (x, y)
+// to (next_x, next_y) hits a block. The blocks hit are destroyed and
+// the sides hit are returned (OBSTACLE_HIT_X and/or OBSTACLE_HIT_Y).
+// It always does the same few lookups into the grid, so the cost does
+// not depend on the number of blocks.
+//---------------------------------------------------------------------
+int obstaclesHit(obstacle_grid *grid, int x, int y, int next_x, int next_y, int size) {
+
+    int hit = 0;
+
+    if (!overlaps(grid, next_x, next_y, size)) {
+        return 0;
+    }
+
+    // Moving only horizontally or only vertically tells which side was hit
+    if (overlaps(grid, next_x, y, size)) {
+        hit |= OBSTACLE_HIT_X;
+        destroyOverlapped(grid, next_x, y, size);
+    }
+
+    if (overlaps(grid, x, next_y, size)) {
+        hit |= OBSTACLE_HIT_Y;
+        destroyOverlapped(grid, x, next_y, size);
+    }
+
+    // Only the corner of a block was hit
+    if (hit == 0) {
+        hit = OBSTACLE_HIT_X | OBSTACLE_HIT_Y;
+        destroyOverlapped(grid, next_x, next_y, size);
+    }
+
+    return hit;
+}
@@ -0,0 +1,202 @@
+/*---------------------------------------------------------------------------------
+
+PongDS - Simple Pong-like game for the Nintendo DS
+
+Author: Asier Iturralde Sarasola
+License: GPL v3
+
+---------------------------------------------------------------------------------*/
+
+#include <nds.h>
+#include <stdlib.h>
+
+#include "paddle_control.h"
+#include "telemetry.h"
+
+// Response to the input of a player: the direction asked for, where the
+// paddle was then and the frames since, until it has moved
+// PADDLE_RESPONSE_DISTANCE pixels that way (or reached the stylus)
+typedef struct {
+    int direction;
+    int start_y;
+    u32 frames;
+    bool waiting;
+    bool touching;  // the stylus was down on the last frame
+    int target_y;   // where the stylus was when the measurement started
+    u32 last;       // frames of the last completed measurement
+} control_response;
+
+static control_response response[2];
+
+//---------------------------------------------------------------------
+// Puts the sub-pixel position at the pixel position and stops the paddle
+//---------------------------------------------------------------------
+void paddleControlReset(paddle *p, int player) {
+
+    p->fy = inttof32(p->y);
+    p->vy = 0;
+
+    response[player].direction = 0;
+    response[player].waiting = false;
+    response[player].touching = false;
+    response[player].last = 0;
+
+}
+
+//---------------------------------------------------------------------
+// Speed of CONTROL_ACCEL: direction is -1 (up), 0 or 1 (down)
+//---------------------------------------------------------------------
+static f32 accelerate(f32 vy, int direction) {
+
+    if (direction == 0) {
+
+        // Slow down until stopped
+        if (vy > PADDLE_DECELERATION) {
+            return vy - PADDLE_DECELERATION;
+        } else if (vy < -PADDLE_DECELERATION) {
+            return vy + PADDLE_DECELERATION;
+        }
+
+        return 0;
+    }
+
+    // Reversing: brake down to a standstill first
+    if (vy * direction < 0) {
+
+        vy += direction * PADDLE_DECELERATION;
+
+        if (vy * direction > 0) {
+            vy = 0;
+        }
+
+        return vy;
+    }
+
+    // Kick off from a standstill (or a slow drift), then accelerate
+    if (vy * direction < PADDLE_START_SPEED) {
+        vy = direction * PADDLE_START_SPEED;
+    } else {
+        vy += direction * PADDLE_ACCELERATION;
+    }
+
+    if (vy > PADDLE_MAX_SPEED) {
+        vy = PADDLE_MAX_SPEED;
+    } else if (vy < -PADDLE_MAX_SPEED) {
+        vy = -PADDLE_MAX_SPEED;
+    }
+
+    return vy;
+}
+
+//---------------------------------------------------------------------
+// Moves a paddle one frame. direction is -1 (up), 0 or 1 (down) for the
+// key schemes; touch_y is the stylus y on the sub screen, or
+// PADDLE_NO_TOUCH, for CONTROL_TOUCH.
+//---------------------------------------------------------------------
+void paddleControlUpdate(paddle *p, int player, int scheme, int direction, int touch_y) {
+
+    control_response *r = &response[player];
+    f32 bottom = inttof32(SCREEN_HEIGHT - p->height);
+    int old_y = p->y;
+    int target_y = -1;
+
+    switch (scheme) {
+
+        case CONTROL_ACCEL:
+            p->vy = accelerate(p->vy, direction);
+            break;
+
+        case CONTROL_TOUCH:
+
+            p->vy = 0;
+
+            if (touch_y != PADDLE_NO_TOUCH) {
+
+                // The center of the paddle goes to the stylus
+                f32 target = inttof32(touch_y - p->height / 2);
+
+                if (target < 0) {
+                    target = 0;
+                } else if (target > bottom) {
+                    target = bottom;
+                }
+
+                // Less than a pixel away: snap to the stylus, the
+                // smoothing alone would never get there
+                if (abs(target - p->fy) < inttof32(1)) {
+                    p->vy = target - p->fy;
+                } else {
+                    p->vy = (f32) (((s64) (target - p->fy) * PADDLE_TOUCH_SMOOTHING) >> 12);
+                }
+
+                target_y = f32toint(target);
+            }
+            break;
+
+        default:
+            p->vy = direction * inttof32(p->speed);
+            break;
+
+    }
+
+    p->fy += p->vy;
+
+    // Don't let the paddle leave the screen
+    if (p->fy < 0) {
+        p->fy = 0;
+        p->vy = 0;
+    } else if (p->fy > bottom) {
+        p->fy = bottom;
+        p->vy = 0;
+    }
+
+    p->y = f32toint(p->fy);
+
+    // A new input starts a new measurement: a new direction of the keys,
+    // or a new press (or a long move) of the stylus away from the paddle
+    if (scheme == CONTROL_TOUCH) {
+
+        if (target_y < 0) {
+            r->waiting = false;
+        } else if (!r->touching || abs(target_y - r->target_y) >= PADDLE_RESPONSE_DISTANCE) {
+            r->direction = target_y < old_y ? -1 : 1;
+            r->start_y = old_y;
+            r->target_y = target_y;
+            r->frames = 0;
+            r->waiting = abs(target_y - old_y) > PADDLE_TOUCH_DEAD_ZONE;
+        }
+
+        r->touching = target_y >= 0;
+
+    } else if (direction != r->direction) {
+        r->direction = direction;
+        r->start_y = old_y;
+        r->frames = 0;
+        r->waiting = direction != 0;
+    }
+
+    if (r->waiting) {
+
+        r->frames++;
+
+        if ((p->y - r->start_y) * r->direction >= PADDLE_RESPONSE_DISTANCE
+                || (target_y >= 0 && p->y != r->start_y && abs(target_y - p->y) <= 1)) {
+
+            telemetryRecord(TELEMETRY_PADDLE_LATENCY, scheme, r->frames, player + 1);
+
+            r->last = r->frames;
+            r->waiting = false;
+        }
+    }
+
+}
+
+//---------------------------------------------------------------------
+// Frames of the last completed response measurement of a player (0 if
+// there is none yet)
+//---------------------------------------------------------------------
+u32 paddleControlResponse(int player) {
+
+    return response[player].last;
+
+}
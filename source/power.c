@@ -0,0 +1,74 @@
+/*---------------------------------------------------------------------------------
+
+PongDS - Simple Pong-like game for the Nintendo DS
+
+Author: Asier Iturralde Sarasola
+License: GPL v3
+
+---------------------------------------------------------------------------------*/
+
+#include <nds.h>
+#include <time.h>
+
+#include "power.h"
+
+static power_stats power_st;
+
+//---------------------------------------------------------------------
+// Takes over the lid: the game sleeps by itself in powerSleep(),
+// after pausing the match
+//---------------------------------------------------------------------
+void powerInit(void) {
+
+    disableSleep();
+
+}
+
+//---------------------------------------------------------------------
+// Turns off both screens and sleeps until the lid is opened again.
+// Called once when the lid is closed.
+//---------------------------------------------------------------------
+void powerSleep(void) {
+
+    time_t before = time(NULL);
+
+    powerOff(POWER_LCD);
+
+    // Returns when the lid is opened
+    systemSleep();
+
+    // Keep the screens off if it woke up with the lid still closed
+    do {
+        swiWaitForVBlank();
+        scanKeys();
+    } while (keysHeld() & KEY_LID);
+
+    powerOn(POWER_LCD);
+
+    // The timers stop while sleeping, the real time clock doesn't
+    power_st.seconds_asleep += time(NULL) - before;
+    power_st.sleeps++;
+
+}
+
+//---------------------------------------------------------------------
+// Counts a frame of the main loop
+//---------------------------------------------------------------------
+void powerFrame(bool idle) {
+
+    if (idle) {
+        power_st.idle_frames++;
+    } else {
+        power_st.active_frames++;
+    }
+
+}
+
+//---------------------------------------------------------------------
+// Returns the battery related metrics
+//---------------------------------------------------------------------
+void powerGetStats(power_stats *stats) {
+
+    *stats = power_st;
+
+}
@@ -0,0 +1,250 @@
+/*---------------------------------------------------------------------------------
+
+PongDS - Simple Pong-like game for the Nintendo DS
+
+Author: Asier Iturralde Sarasola
+License: GPL v3
+
+---------------------------------------------------------------------------------*/
+
+#include <nds.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "snapshot.h"
+#include "telemetry.h"
+
+// Saved file: an 8 byte header ("PDSG", version and size of the data)
+// followed by the fields of the game state, little endian and packed
+#define SAVE_HEADER_SIZE 8
+#define SAVE_BALL_SIZE (3 * 8 + 4)
+#define SAVE_PADDLE_SIZE (6 * 2 + 2 * 4)
+#define SAVE_GRID_SIZE (OBSTACLE_ROWS * 4 + 2)
+#define SAVE_DATA_SIZE (SAVE_BALL_SIZE + 2 * SAVE_PADDLE_SIZE + SAVE_GRID_SIZE + 3)
+
+// Flags of the saved game state
+#define SAVE_GAME_ENDED 1
+#define SAVE_OBSTACLES 2
+
+// A frame of the ring: the game state and the telemetry recorded until
+// then, so rewinding also forgets the serves, hits and goals undone
+typedef struct {
+    game_state gs;
+    u32 telemetry_head;
+    u32 telemetry_frame;
+} snapshot_entry;
+
+static snapshot_entry snapshot_ring[SNAPSHOT_RING_SIZE];
+static u32 snapshot_next = 0;      // index of the next push
+static u32 snapshot_count = 0;
+
+//---------------------------------------------------------------------
+// Forgets the snapshots of the previous match
+//---------------------------------------------------------------------
+void snapshotRingClear(void) {
+
+    snapshot_next = 0;
+    snapshot_count = 0;
+
+}
+
+//---------------------------------------------------------------------
+// Stores the state of this frame, overwriting the oldest one when full
+//---------------------------------------------------------------------
+void snapshotPush(const game_state *gs) {
+
+    snapshot_entry *e = &snapshot_ring[snapshot_next];
+
+    snapshotTake(&e->gs, gs);
+    e->telemetry_head = telemetry_head;
+    e->telemetry_frame = telemetry_frame;
+
+    snapshot_next = snapshot_next + 1 < SNAPSHOT_RING_SIZE ? snapshot_next + 1 : 0;
+
+    if (snapshot_count < SNAPSHOT_RING_SIZE) {
+        snapshot_count++;
+    }
+
+}
+
+//---------------------------------------------------------------------
+// Goes back one frame, dropping the telemetry events recorded since.
+// Returns false when there is nothing to rewind.
+//---------------------------------------------------------------------
+bool snapshotRewind(game_state *gs) {
+
+    if (snapshot_count == 0) {
+        return false;
+    }
+
+    snapshot_next = snapshot_next > 0 ? snapshot_next - 1 : SNAPSHOT_RING_SIZE - 1;
+    snapshot_count--;
+
+    snapshotRestore(gs, &snapshot_ring[snapshot_next].gs);
+    telemetry_head = snapshot_ring[snapshot_next].telemetry_head;
+    telemetry_frame = snapshot_ring[snapshot_next].telemetry_frame;
+
+    return true;
+}
+
+static u8 *put16(u8 *p, u32 v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    return p + 2;
+}
+
+static u8 *put32(u8 *p, u32 v) {
+    p = put16(p, v & 0xFFFF);
+    return put16(p, v >> 16);
+}
+
+static u8 *putDouble(u8 *p, double d) {
+    u32 v[2];
+    memcpy(v, &d, sizeof(v));   // the ARM9 stores doubles as two little endian words, low word first
+    p = put32(p, v[0]);
+    return put32(p, v[1]);
+}
+
+static u8 *putPaddle(u8 *p, const paddle *pd) {
+    p = put16(p, pd->x);
+    p = put16(p, pd->y);
+    p = put16(p, pd->speed);
+    p = put16(p, pd->height);
+    p = put16(p, pd->width);
+    p = put16(p, pd->score);
+    p = put32(p, pd->fy);
+    return put32(p, pd->vy);
+}
+
+static u32 get16(const u8 **p) {
+    u32 v = (*p)[0] | ((*p)[1] << 8);
+    *p += 2;
+    return v;
+}
+
+static u32 get32(const u8 **p) {
+    u32 v = get16(p);
+    return v | (get16(p) << 16);
+}
+
+static double getDouble(const u8 **p) {
+    u32 v[2];
+    double d;
+    v[0] = get32(p);
+    v[1] = get32(p);
+    memcpy(&d, v, sizeof(d));
+    return d;
+}
+
+static void getPaddle(const u8 **p, paddle *pd) {
+    pd->x = (s16) get16(p);
+    pd->y = (s16) get16(p);
+    pd->speed = (s16) get16(p);
+    pd->height = (s16) get16(p);
+    pd->width = (s16) get16(p);
+    pd->score = (s16) get16(p);
+    pd->fy = (s32) get32(p);
+    pd->vy = (s32) get32(p);
+}
+
+//---------------------------------------------------------------------
+// Writes the game state to SNAPSHOT_FILE. Returns false if the SD card
+// is missing (it is mounted by telemetryInit()).
+//---------------------------------------------------------------------
+bool snapshotSave(const game_state *gs) {
+
+    u8 data[SAVE_HEADER_SIZE + SAVE_DATA_SIZE];
+    u8 *p = data;
+    bool ok;
+    int y;
+    FILE *f;
+
+    memcpy(p, "PDSG", 4);
+    p = put16(p + 4, SNAPSHOT_VERSION);
+    p = put16(p, SAVE_DATA_SIZE);
+
+    p = putDouble(p, gs->b.x);
+    p = putDouble(p, gs->b.y);
+    p = putDouble(p, gs->b.speed);
+    p = put32(p, gs->b.angle);
+
+    p = putPaddle(p, &gs->p1);
+    p = putPaddle(p, &gs->p2);
+
+    for (y = 0; y < OBSTACLE_ROWS; y++) {
+        p = put32(p, gs->grid.rows[y]);
+    }
+
+    p = put16(p, gs->grid.count);
+
+    *p++ = gs->state;
+    *p++ = gs->language;
+    *p++ = (gs->game_ended ? SAVE_GAME_ENDED : 0) | (gs->obstacles_enabled ? SAVE_OBSTACLES : 0);
+
+    f = fopen(SNAPSHOT_FILE, "wb");
+
+    if (f == NULL) {
+        return false;
+    }
+
+    ok = fwrite(data, sizeof(data), 1, f) == 1;
+
+    fclose(f);
+
+    return ok;
+}
+
+//---------------------------------------------------------------------
+// Reads the game state saved in SNAPSHOT_FILE. Returns false (and does
+// not touch gs) if there is no saved game or it has another version.
+//---------------------------------------------------------------------
+bool snapshotLoad(game_state *gs) {
+
+    u8 data[SAVE_HEADER_SIZE + SAVE_DATA_SIZE];
+    const u8 *p = data + 4;
+    game_state loaded;
+    bool ok;
+    int y;
+    FILE *f = fopen(SNAPSHOT_FILE, "rb");
+
+    if (f == NULL) {
+        return false;
+    }
+
+    ok = fread(data, sizeof(data), 1, f) == 1;
+
+    fclose(f);
+
+    if (!ok || memcmp(data, "PDSG", 4) != 0 || get16(&p) != SNAPSHOT_VERSION || get16(&p) != SAVE_DATA_SIZE) {
+        return false;
+    }
+
+    loaded.b.x = getDouble(&p);
+    loaded.b.y = getDouble(&p);
+    loaded.b.speed = getDouble(&p);
+    loaded.b.angle = (s32) get32(&p);
+
+    getPaddle(&p, &loaded.p1);
+    getPaddle(&p, &loaded.p2);
+
+    for (y = 0; y < OBSTACLE_ROWS; y++) {
+        loaded.grid.rows[y] = get32(&p);
+    }
+
+    loaded.grid.count = get16(&p);
+
+    loaded.state = *p++;
+    loaded.language = *p++;
+    loaded.game_ended = (*p & SAVE_GAME_ENDED) != 0;
+    loaded.obstacles_enabled = (*p & SAVE_OBSTACLES) != 0;
+
+    // Only matches are saved, and there are digit sprites up to 11
+    if ((loaded.state != ONE_PLAYER_GAME && loaded.state != TWO_PLAYERS_GAME) || loaded.language > FR
+            || loaded.p1.score < 0 || loaded.p1.score > 11 || loaded.p2.score < 0 || loaded.p2.score > 11) {
+        return false;
+    }
+
+    snapshotRestore(gs, &loaded);
+
+    return true;
+}
@@ -0,0 +1,144 @@
+/*---------------------------------------------------------------------------------
+
+PongDS - Simple Pong-like game for the Nintendo DS
+
+Author: Asier Iturralde Sarasola
+License: GPL v3
+
+---------------------------------------------------------------------------------*/
+
+#include <nds.h>
+#include <fat.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "music.h"
+#include "power.h"
+#include "telemetry.h"
+
+telemetry_event telemetry_ring[TELEMETRY_CAPACITY];
+u32 telemetry_head = 0;
+u32 telemetry_frame = 0;
+bool telemetry_active = false;
+
+static unsigned int telemetry_mode;
+static bool telemetry_fat_ok = false;
+static u32 telemetry_underruns = 0;
+static power_stats telemetry_power;     // at the start of the match
+
+//---------------------------------------------------------------------
+// Mounts the SD card (if there is one)
+//---------------------------------------------------------------------
+void telemetryInit(void) {
+
+    telemetry_fat_ok = fatInitDefault();
+
+}
+
+//---------------------------------------------------------------------
+// Empties the ring and starts recording a new match
+//---------------------------------------------------------------------
+void telemetryStartMatch(unsigned int mode) {
+
+    telemetry_head = 0;
+    telemetry_frame = 0;
+    telemetry_mode = mode;
+    telemetry_active = true;
+
+    powerGetStats(&telemetry_power);
+
+}
+
+//---------------------------------------------------------------------
+// Called once per simulated frame, before waiting for the vertical
+// blank. The frame timer is restarted at the top of the main loop.
+//---------------------------------------------------------------------
+void telemetryFrame(void) {
+
+    music_stats music;
+    u32 underruns;
+
+    if (telemetry_frame % TELEMETRY_FRAME_INTERVAL == 0) {
+
+        telemetryRecord(TELEMETRY_FRAME_TIME, 0, 0, cpuGetTiming());
+
+        // How close the music stream was to running dry since the last sample
+        musicGetStats(&music);
+        musicResetMinFill();
+
+        underruns = music.underruns - telemetry_underruns;
+        telemetry_underruns = music.underruns;
+
+        if (music.playing) {
+            telemetryRecord(TELEMETRY_MUSIC, 0, underruns > 0x7FFF ? 0x7FFF : underruns, music.min_fill);
+        }
+    }
+
+    telemetry_frame++;
+
+}
+
+//---------------------------------------------------------------------
+// Appends the recorded match to TELEMETRY_FILE and stops recording.
+// Returns false if there was nothing to write or the card is missing.
+//---------------------------------------------------------------------
+bool telemetryFlush(int p1_score, int p2_score) {
+
+    telemetry_header h;
+    u32 count, first, i;
+    power_stats power;
+    FILE *f;
+
+    if (!telemetry_active) {
+        return false;
+    }
+
+    telemetry_active = false;
+
+    // What the match cost in battery: active and idle (paused) frames and sleeps
+    powerGetStats(&power);
+
+    telemetryRecord(TELEMETRY_POWER, TELEMETRY_POWER_ACTIVE_FRAMES, 0, power.active_frames - telemetry_power.active_frames);
+    telemetryRecord(TELEMETRY_POWER, TELEMETRY_POWER_IDLE_FRAMES, 0, power.idle_frames - telemetry_power.idle_frames);
+    telemetryRecord(TELEMETRY_POWER, TELEMETRY_POWER_SLEEPS, 0, power.sleeps - telemetry_power.sleeps);
+    telemetryRecord(TELEMETRY_POWER, TELEMETRY_POWER_SECONDS_ASLEEP, 0, power.seconds_asleep - telemetry_power.seconds_asleep);
+
+    if (!telemetry_fat_ok) {
+        return false;
+    }
+
+    count = telemetry_head < TELEMETRY_CAPACITY ? telemetry_head : TELEMETRY_CAPACITY;
+    first = telemetry_head - count;
+
+    memcpy(h.magic, "PDST", 4);
+    h.version = TELEMETRY_VERSION;
+    h.event_size = sizeof(telemetry_event);
+    h.mode = telemetry_mode;
+    h.frames = telemetry_frame;
+    h.event_count = count;
+    h.dropped = telemetry_head - count;
+    h.p1_score = p1_score;
+    h.p2_score = p2_score;
+
+    f = fopen(TELEMETRY_FILE, "ab");
+
+    if (f == NULL) {
+        return false;
+    }
+
+    fwrite(&h, sizeof(h), 1, f);
+
+    // The ring may wrap around, write it oldest event first in (at most) two chunks
+    i = first & (TELEMETRY_CAPACITY - 1);
+
+    if (i + count > TELEMETRY_CAPACITY) {
+        fwrite(&telemetry_ring[i], sizeof(telemetry_event), TELEMETRY_CAPACITY - i, f);
+        fwrite(&telemetry_ring[0], sizeof(telemetry_event), i + count - TELEMETRY_CAPACITY, f);
+    } else {
+        fwrite(&telemetry_ring[i], sizeof(telemetry_event), count, f);
+    }
+
+    fclose(f);
+
+    return true;
+}
@@ -0,0 +1,65 @@
+/*---------------------------------------------------------------------------------
+
+PongDS - Simple Pong-like game for the Nintendo DS
+
+Author: Asier Iturralde Sarasola
+License: GPL v3
+
+---------------------------------------------------------------------------------*/
+
+#ifdef FRAME_TRACE
+
+#include <nds.h>
+#include <stdio.h>
+
+#include "trace.h"
+
+static u32 trace_frame = 0;
+static bool trace_ended = false;
+
+//---------------------------------------------------------------------
+// Bus clock ticks from the start of main() to the first frame
+//---------------------------------------------------------------------
+void traceBoot(u32 ticks) {
+
+    char line[48];
+
+    sprintf(line, "PDSI boot_ticks=%lu\n", (unsigned long) ticks);
+    nocashMessage(line);
+
+}
+
+//---------------------------------------------------------------------
+// Bus clock ticks spent in the work of a frame (without the wait for
+// the vertical blank), and how many of them came after the wait (OAM
+// update and music refill)
+//---------------------------------------------------------------------
+void traceFrame(u32 ticks, u32 post_vblank_ticks, unsigned int state, bool idle) {
+
+    char line[96];
+
+    if (trace_ended) {
+        return;
+    }
+
+    sprintf(line, "PDSF frame=%lu state=%u idle=%d ticks=%lu post_vblank_ticks=%lu\n",
+            (unsigned long) trace_frame, state, idle, (unsigned long) ticks, (unsigned long) post_vblank_ticks);
+    nocashMessage(line);
+
+    trace_frame++;
+
+}
+
+//---------------------------------------------------------------------
+// Tells the test harness that the input script is over
+//---------------------------------------------------------------------
+void traceEnd(void) {
+
+    if (!trace_ended) {
+        nocashMessage("PDSE end\n");
+        trace_ended = true;
+    }
+
+}
+
+#endif
@@ -0,0 +1,592 @@
+/*---------------------------------------------------------------------------------
+
+PongDS - Simple Pong-like game for the Nintendo DS
+
+Host tool for the streamed music files (see include/music_format.h).
+
+Build: cc -O2 -Iinclude -o pdsm tools/pdsm.c
+Usage: pdsm encode track.wav track.pdsm [loop start sample]
+       pdsm decode track.pdsm track.wav
+       pdsm info track.pdsm
+       pdsm selftest [directory for the temporary files]
+
+encode converts a PCM WAV file (8 or 16 bit, mono or stereo) to signed
+8 bit mono. The track loops from the start unless another loop start is
+given (the length of the track makes it play once). decode reads a .pdsm
+file with the same checks as the game and writes it back as a WAV file.
+selftest encodes generated WAV files, decodes them and checks the samples,
+the header checks and the loop start, then streams them through the ring
+buffer code of the game (include/music_ring.h). It returns 0 on success.
+
+Author: Asier Iturralde Sarasola
+License: GPL v3
+
+---------------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "music_format.h"
+#include "music_ring.h"
+
+static unsigned long u32le(const unsigned char *p) {
+    return (unsigned long) p[0] | ((unsigned long) p[1] << 8) | ((unsigned long) p[2] << 16) | ((unsigned long) p[3] << 24);
+}
+
+static unsigned int u16le(const unsigned char *p) {
+    return p[0] | (p[1] << 8);
+}
+
+static void put32(unsigned char *p, unsigned long v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+
+static void put16(unsigned char *p, unsigned int v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+}
+
+static unsigned char *readFile(const char *path, unsigned long *size) {
+
+    unsigned char *data;
+    long length;
+    FILE *f = fopen(path, "rb");
+
+    if (f == NULL) {
+        perror(path);
+        return NULL;
+    }
+
+    fseek(f, 0, SEEK_END);
+    length = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    data = malloc(length > 0 ? length : 1);
+
+    if (data == NULL || fread(data, 1, length, f) != (size_t) length) {
+        fprintf(stderr, "%s: read error\n", path);
+        fclose(f);
+        free(data);
+        return NULL;
+    }
+
+    fclose(f);
+    *size = length;
+
+    return data;
+}
+
+//---------------------------------------------------------------------
+// Parses and validates a .pdsm file, like musicPlay() does in the game
+//---------------------------------------------------------------------
+static int parseHeader(const unsigned char *data, unsigned long size, music_header *h) {
+
+    if (size < MUSIC_HEADER_SIZE || memcmp(data, MUSIC_MAGIC, 4) != 0) {
+        fprintf(stderr, "not a .pdsm file\n");
+        return -1;
+    }
+
+    memcpy(h->magic, data, 4);
+    h->version = u16le(data + 4);
+    h->format = u16le(data + 6);
+    h->sample_rate = u32le(data + 8);
+    h->sample_count = u32le(data + 12);
+    h->loop_start = u32le(data + 16);
+
+    if (!musicHeaderValid(h)) {
+        fprintf(stderr, "unsupported version %u or format %u\n", h->version, h->format);
+        return -1;
+    }
+
+    if (size - MUSIC_HEADER_SIZE < h->sample_count) {
+        fprintf(stderr, "truncated file: %lu of %lu samples\n",
+                size - MUSIC_HEADER_SIZE, (unsigned long) h->sample_count);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int encode(const char *in, const char *out, unsigned long loop_start) {
+
+    unsigned long size, pos = 12, data_size = 0, i, count;
+    unsigned int channels = 0, bits = 0;
+    unsigned long rate = 0;
+    const unsigned char *samples = NULL;
+    unsigned char header[MUSIC_HEADER_SIZE];
+    unsigned char *wav = readFile(in, &size);
+    FILE *f;
+
+    if (wav == NULL) {
+        return 1;
+    }
+
+    if (size < 12 || memcmp(wav, "RIFF", 4) != 0 || memcmp(wav + 8, "WAVE", 4) != 0) {
+        fprintf(stderr, "%s: not a WAV file\n", in);
+        return 1;
+    }
+
+    // Walk the chunks looking for "fmt " and "data"
+    while (pos + 8 <= size) {
+
+        unsigned long length = u32le(wav + pos + 4);
+
+        if (memcmp(wav + pos, "fmt ", 4) == 0 && length >= 16) {
+            if (u16le(wav + pos + 8) != 1) {
+                fprintf(stderr, "%s: only PCM WAV files are supported\n", in);
+                return 1;
+            }
+            channels = u16le(wav + pos + 10);
+            rate = u32le(wav + pos + 12);
+            bits = u16le(wav + pos + 22);
+        } else if (memcmp(wav + pos, "data", 4) == 0) {
+            samples = wav + pos + 8;
+            data_size = length < size - pos - 8 ? length : size - pos - 8;
+        }
+
+        pos += 8 + length + (length & 1);
+    }
+
+    if (samples == NULL || channels == 0 || (bits != 8 && bits != 16)) {
+        fprintf(stderr, "%s: unsupported WAV file\n", in);
+        return 1;
+    }
+
+    count = data_size / (channels * bits / 8);
+
+    if (loop_start > count) {
+        loop_start = count;
+    }
+
+    f = fopen(out, "wb");
+
+    if (f == NULL) {
+        perror(out);
+        return 1;
+    }
+
+    memcpy(header, MUSIC_MAGIC, 4);
+    put16(header + 4, MUSIC_FORMAT_VERSION);
+    put16(header + 6, MUSIC_PCM8);
+    put32(header + 8, rate);
+    put32(header + 12, count);
+    put32(header + 16, loop_start);
+    fwrite(header, MUSIC_HEADER_SIZE, 1, f);
+
+    // Mix down to mono and convert to signed 8 bit
+    for (i = 0; i < count; i++) {
+
+        long sum = 0;
+        unsigned int c;
+
+        for (c = 0; c < channels; c++) {
+            if (bits == 8) {
+                sum += ((long) samples[(i * channels + c)] - 128) << 8;
+            } else {
+                const unsigned char *s = samples + (i * channels + c) * 2;
+                sum += (short) (s[0] | (s[1] << 8));
+            }
+        }
+
+        fputc((signed char) ((sum / (long) channels) >> 8), f);
+    }
+
+    fclose(f);
+    free(wav);
+
+    printf("%s: %lu samples at %lu Hz, %lu bytes\n", out, count, rate, count + MUSIC_HEADER_SIZE);
+
+    return 0;
+}
+
+static int decode(const char *in, const char *out) {
+
+    unsigned long size, i;
+    unsigned char header[44];
+    music_header h;
+    unsigned char *data = readFile(in, &size);
+    FILE *f;
+
+    if (data == NULL || parseHeader(data, size, &h) != 0) {
+        return 1;
+    }
+
+    f = fopen(out, "wb");
+
+    if (f == NULL) {
+        perror(out);
+        return 1;
+    }
+
+    // Unsigned 8 bit mono WAV
+    memcpy(header, "RIFF", 4);
+    put32(header + 4, 36 + h.sample_count);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    put32(header + 16, 16);
+    put16(header + 20, 1);
+    put16(header + 22, 1);
+    put32(header + 24, h.sample_rate);
+    put32(header + 28, h.sample_rate);
+    put16(header + 32, 1);
+    put16(header + 34, 8);
+    memcpy(header + 36, "data", 4);
+    put32(header + 40, h.sample_count);
+    fwrite(header, sizeof(header), 1, f);
+
+    for (i = 0; i < h.sample_count; i++) {
+        fputc((data[MUSIC_HEADER_SIZE + i] + 128) & 0xFF, f);
+    }
+
+    fclose(f);
+    free(data);
+
+    return 0;
+}
+
+static int info(const char *in) {
+
+    unsigned long size;
+    music_header h;
+    unsigned char *data = readFile(in, &size);
+
+    if (data == NULL || parseHeader(data, size, &h) != 0) {
+        return 1;
+    }
+
+    printf("version:     %u\n", h.version);
+    printf("sample rate: %lu Hz\n", (unsigned long) h.sample_rate);
+    printf("samples:     %lu (%.1f s)\n", (unsigned long) h.sample_count, (double) h.sample_count / h.sample_rate);
+    printf("loop start:  %lu%s\n", (unsigned long) h.loop_start, h.loop_start >= h.sample_count ? " (no loop)" : "");
+    printf("stream rate: %lu bytes per frame\n", (unsigned long) (h.sample_rate / 60 + 1));
+
+    free(data);
+
+    return 0;
+}
+
+//---------------------------------------------------------------------
+// Self test
+//---------------------------------------------------------------------
+
+#define TEST_SAMPLES 5000
+#define TEST_RING_SIZE 256      // small, so the stream wraps around it often
+
+static int test_failures = 0;
+static int test_checks = 0;
+
+static void check(int ok, const char *what) {
+
+    test_checks++;
+
+    if (!ok) {
+        fprintf(stderr, "FAIL: %s\n", what);
+        test_failures++;
+    }
+}
+
+//---------------------------------------------------------------------
+// Writes a PCM WAV file with the given raw sample data
+//---------------------------------------------------------------------
+static int writeWav(const char *path, unsigned int channels, unsigned int bits,
+                    const unsigned char *samples, unsigned long size) {
+
+    unsigned char header[44];
+    unsigned int block = channels * bits / 8;
+    FILE *f = fopen(path, "wb");
+
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    memcpy(header, "RIFF", 4);
+    put32(header + 4, 36 + size);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    put32(header + 16, 16);
+    put16(header + 20, 1);
+    put16(header + 22, channels);
+    put32(header + 24, 22050);
+    put32(header + 28, 22050 * block);
+    put16(header + 32, block);
+    put16(header + 34, bits);
+    memcpy(header + 36, "data", 4);
+    put32(header + 40, size);
+
+    fwrite(header, sizeof(header), 1, f);
+    fwrite(samples, 1, size, f);
+    fclose(f);
+
+    return 0;
+}
+
+//---------------------------------------------------------------------
+// Stream of the game on the host: the reading of the track of
+// musicFill() in source/music.c (the pieces come from musicRingChunk()
+// for both), from memory instead of a file
+//---------------------------------------------------------------------
+typedef struct {
+    int8_t ring[TEST_RING_SIZE];
+    uint32_t write;
+    uint32_t read;
+    uint32_t position;
+    int ended;
+    const int8_t *track;
+    music_header h;
+} test_stream;
+
+static void testFill(test_stream *st, uint32_t max_bytes) {
+
+    uint32_t free = TEST_RING_SIZE - (st->write - st->read);
+    uint32_t todo = free < max_bytes ? free : max_bytes;
+
+    while (todo > 0 && !st->ended) {
+
+        uint32_t chunk = musicRingChunk(TEST_RING_SIZE, st->write, todo, &st->position,
+                                        st->h.sample_count, st->h.loop_start);
+
+        if (chunk == 0) {
+            st->ended = 1;
+            break;
+        }
+
+        memcpy(&st->ring[st->write & (TEST_RING_SIZE - 1)], st->track + st->position, chunk);
+
+        st->write += chunk;
+        st->position += chunk;
+        todo -= chunk;
+    }
+
+}
+
+//---------------------------------------------------------------------
+// Streams a track through the ring with uneven refills and requests
+// (like the main loop and the Maxmod callback) and checks that the
+// samples come out in order, looping from loop_start
+//---------------------------------------------------------------------
+static void testStream(const int8_t *track, const music_header *h) {
+
+    static test_stream st;
+    int8_t out[128];
+    unsigned long played = 0, expected_index = 0, total = 3UL * h->sample_count;
+    int in_order = 1, silence_ok = 1, underrun_only_when_empty = 1;
+    int ended = 0;
+
+    memset(&st, 0, sizeof(st));
+    st.track = track;
+    st.h = *h;
+
+    srand(7);
+    testFill(&st, TEST_RING_SIZE);
+
+    while (played < total) {
+
+        uint32_t length = 1 + rand() % sizeof(out);
+        uint32_t available = st.write - st.read;
+        uint32_t count = musicRingRead(st.ring, TEST_RING_SIZE, st.read, st.write, out, length);
+        uint32_t i;
+
+        if (count != (length < available ? length : available)) {
+            underrun_only_when_empty = 0;
+        }
+
+        for (i = 0; i < count; i++) {
+
+            if (expected_index >= h->sample_count) {
+                expected_index = h->loop_start;
+            }
+
+            if (expected_index >= h->sample_count || out[i] != track[expected_index]) {
+                in_order = 0;
+            }
+
+            expected_index++;
+        }
+
+        for (i = count; i < length; i++) {
+            if (out[i] != 0) {
+                silence_ok = 0;
+            }
+        }
+
+        st.read += count;
+        played += length;
+
+        if (st.ended && st.write == st.read) {
+            ended = 1;
+            break;
+        }
+
+        testFill(&st, 1 + rand() % 96);
+    }
+
+    check(in_order, "stream: samples out of order");
+    check(silence_ok, "stream: underruns are not silent");
+    check(underrun_only_when_empty, "stream: fewer samples than available");
+
+    if (h->loop_start < h->sample_count) {
+        check(!ended && played >= total, "stream: looping track ended");
+    } else {
+        check(ended && expected_index == h->sample_count, "stream: track without loop did not end after its last sample");
+    }
+
+}
+
+//---------------------------------------------------------------------
+// Encodes wav_path, checks the header and samples against expected and
+// returns the encoded file (NULL on failure)
+//---------------------------------------------------------------------
+static unsigned char *testEncode(const char *wav_path, const char *pdsm_path, unsigned long loop_start,
+                                 const signed char *expected, unsigned long count, unsigned long expected_loop,
+                                 unsigned long *size) {
+
+    music_header h;
+    unsigned char *data;
+    unsigned long i;
+    int same = 1;
+
+    if (encode(wav_path, pdsm_path, loop_start) != 0 || (data = readFile(pdsm_path, size)) == NULL) {
+        check(0, "encode");
+        return NULL;
+    }
+
+    if (parseHeader(data, *size, &h) != 0) {
+        check(0, "encoded header is not valid");
+        free(data);
+        return NULL;
+    }
+
+    check(h.sample_count == count, "encode: sample count");
+    check(h.sample_rate == 22050, "encode: sample rate");
+    check(h.loop_start == expected_loop, "encode: loop start");
+    check(*size == MUSIC_HEADER_SIZE + count, "encode: file size");
+
+    for (i = 0; i < count && i < h.sample_count; i++) {
+        if ((signed char) data[MUSIC_HEADER_SIZE + i] != expected[i]) {
+            same = 0;
+        }
+    }
+
+    check(same, "encode: samples");
+
+    return data;
+}
+
+static int selftest(const char *dir) {
+
+    static unsigned char wav16[TEST_SAMPLES * 4], wav8[TEST_SAMPLES];
+    static signed char expected16[TEST_SAMPLES], expected8[TEST_SAMPLES];
+    char wav_path[1024], pdsm_path[1024], out_path[1024];
+    unsigned char bad[MUSIC_HEADER_SIZE + 16];
+    unsigned char *data, *decoded;
+    unsigned long size, decoded_size, i;
+    music_header h;
+    int same;
+
+    snprintf(wav_path, sizeof(wav_path), "%s/pdsm_selftest.wav", dir);
+    snprintf(pdsm_path, sizeof(pdsm_path), "%s/pdsm_selftest.pdsm", dir);
+    snprintf(out_path, sizeof(out_path), "%s/pdsm_selftest_out.wav", dir);
+
+    // 16 bit stereo with the same sample on both channels, and 8 bit mono
+    for (i = 0; i < TEST_SAMPLES; i++) {
+
+        long v = (long) ((i * 7919) % 65536) - 32768;
+
+        put16(wav16 + i * 4, (unsigned int) v & 0xFFFF);
+        put16(wav16 + i * 4 + 2, (unsigned int) v & 0xFFFF);
+        expected16[i] = (signed char) (v >= 0 ? v / 256 : -((-v + 255) / 256));
+
+        wav8[i] = (i * 13) & 0xFF;
+        expected8[i] = (signed char) ((int) wav8[i] - 128);
+    }
+
+    // 16 bit stereo, looping from sample 1000
+    if (writeWav(wav_path, 2, 16, wav16, sizeof(wav16)) != 0) {
+        return 1;
+    }
+
+    data = testEncode(wav_path, pdsm_path, 1000, expected16, TEST_SAMPLES, 1000, &size);
+
+    if (data != NULL) {
+
+        // Decoding gives back the samples as unsigned 8 bit
+        same = decode(pdsm_path, out_path) == 0 && (decoded = readFile(out_path, &decoded_size)) != NULL;
+
+        if (same) {
+            same = decoded_size == 44 + TEST_SAMPLES && u32le(decoded + 24) == 22050;
+            for (i = 0; same && i < TEST_SAMPLES; i++) {
+                same = decoded[44 + i] == ((expected16[i] + 128) & 0xFF);
+            }
+            free(decoded);
+        }
+
+        check(same, "decode: samples");
+
+        parseHeader(data, size, &h);
+        testStream((const int8_t *) data + MUSIC_HEADER_SIZE, &h);
+
+        // The header checks of the game
+        memcpy(bad, data, sizeof(bad));
+        check(parseHeader(bad, sizeof(bad), &h) != 0, "truncated file accepted");
+
+        memcpy(bad, data, sizeof(bad));
+        bad[0] = 'X';
+        check(parseHeader(bad, size, &h) != 0, "bad magic accepted");
+
+        memcpy(bad, data, sizeof(bad));
+        put16(bad + 4, MUSIC_FORMAT_VERSION + 1);
+        check(parseHeader(bad, size, &h) != 0, "other version accepted");
+
+        memcpy(bad, data, sizeof(bad));
+        put16(bad + 6, MUSIC_PCM8 + 1);
+        check(parseHeader(bad, size, &h) != 0, "other sample format accepted");
+
+        free(data);
+    }
+
+    // 8 bit mono, the loop start past the end is clamped: the track plays once
+    if (writeWav(wav_path, 1, 8, wav8, sizeof(wav8)) != 0) {
+        return 1;
+    }
+
+    data = testEncode(wav_path, pdsm_path, TEST_SAMPLES + 500, expected8, TEST_SAMPLES, TEST_SAMPLES, &size);
+
+    if (data != NULL) {
+        parseHeader(data, size, &h);
+        testStream((const int8_t *) data + MUSIC_HEADER_SIZE, &h);
+        free(data);
+    }
+
+    remove(wav_path);
+    remove(pdsm_path);
+    remove(out_path);
+
+    printf("selftest: %d checks, %d failed\n", test_checks, test_failures);
+
+    return test_failures > 0;
+}
+
+int main(int argc, char *argv[]) {
+
+    if (argc == 4 && strcmp(argv[1], "encode") == 0) {
+        return encode(argv[2], argv[3], 0);
+    } else if (argc == 5 && strcmp(argv[1], "encode") == 0) {
+        return encode(argv[2], argv[3], strtoul(argv[4], NULL, 10));
+    } else if (argc == 4 && strcmp(argv[1], "decode") == 0) {
+        return decode(argv[2], argv[3]);
+    } else if (argc == 3 && strcmp(argv[1], "info") == 0) {
+        return info(argv[2]);
+    } else if (argc <= 3 && argc >= 2 && strcmp(argv[1], "selftest") == 0) {
+        return selftest(argc == 3 ? argv[2] : ".");
+    }
+
+    fprintf(stderr, "usage: pdsm encode track.wav track.pdsm [loop start sample]\n"
+                    "       pdsm decode track.pdsm track.wav\n"
+                    "       pdsm info track.pdsm\n"
+                    "       pdsm selftest [directory]\n");
+
+    return 2;
+}
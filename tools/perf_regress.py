@@ -0,0 +1,176 @@
+#!/usr/bin/env python3
+#---------------------------------------------------------------------------------
+#
+# PongDS - Simple Pong-like game for the Nintendo DS
+#
+# Emulator performance regression test. Runs the ROM built with
+# "make PERF_TEST=1" in an emulator, reads the frame trace that the game
+# writes to the no$gba debug output and compares it with a stored baseline.
+#
+# The emulator must print the debug messages of the game to its standard
+# output or error (check that your melonDS or DeSmuME build does). It is
+# run with --emulator, where {rom} is replaced by the path of the ROM:
+#
+#   tools/perf_regress.py --rom PongDS_perf.nds --emulator "xvfb-run -a melonDS {rom}"
+#
+# The default command can also be set in the PONGDS_EMULATOR environment
+# variable. Run it once with --update-baseline to store the baseline.
+#
+# Author: Asier Iturralde Sarasola
+# License: GPL v3
+#
+#---------------------------------------------------------------------------------
+
+import argparse
+import json
+import os
+import re
+import shlex
+import subprocess
+import sys
+import threading
+
+BUS_CLOCK = 33513982
+
+# state values of enum state_options in include/game_state.h
+GAME_STATES = (2, 3)
+
+FRAME_RE = re.compile(r"PDSF frame=(\d+) state=(\d+) idle=(\d) ticks=(\d+)")
+BOOT_RE = re.compile(r"PDSI boot_ticks=(\d+)")
+END_RE = re.compile(r"PDSE end")
+
+DEFAULT_BASELINE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "perf_baseline.json")
+
+
+def run_emulator(command, timeout):
+    """Runs the emulator until the game reports the end of the input script."""
+
+    boot_ticks = None
+    frames = []
+    ended = False
+
+    process = subprocess.Popen(command, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                               universal_newlines=True, errors="replace")
+
+    # Kill the emulator if the game never reaches the end of the script
+    timer = threading.Timer(timeout, process.kill)
+    timer.start()
+
+    try:
+        for line in process.stdout:
+
+            match = FRAME_RE.search(line)
+            if match:
+                frames.append((int(match.group(2)), match.group(3) == "1", int(match.group(4))))
+            elif BOOT_RE.search(line):
+                boot_ticks = int(BOOT_RE.search(line).group(1))
+            elif END_RE.search(line):
+                ended = True
+                break
+    finally:
+        timer.cancel()
+        process.kill()
+        process.wait()
+
+    return boot_ticks, frames, ended
+
+
+def percentile(values, fraction):
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * fraction))]
+
+
+def summarize(boot_ticks, frames):
+    """Frame time statistics of the frames that simulated a match."""
+
+    game = [ticks for state, idle, ticks in frames if state in GAME_STATES and not idle]
+
+    if boot_ticks is None or not game:
+        return None
+
+    return {
+        "boot_ticks": boot_ticks,
+        "game_frames": len(game),
+        "frame_ticks_mean": sum(game) / len(game),
+        "frame_ticks_p95": percentile(game, 0.95),
+        "frame_ticks_max": max(game),
+    }
+
+
+def ms(ticks):
+    return ticks * 1000.0 / BUS_CLOCK
+
+
+def main():
+
+    parser = argparse.ArgumentParser(description="Pong DS emulator performance regression test")
+    parser.add_argument("--rom", required=True, help="ROM built with make PERF_TEST=1")
+    parser.add_argument("--emulator", default=os.environ.get("PONGDS_EMULATOR", "desmume-cli {rom}"),
+                        help="emulator command, {rom} is replaced by the ROM path")
+    parser.add_argument("--baseline", default=DEFAULT_BASELINE, help="baseline JSON file")
+    parser.add_argument("--update-baseline", action="store_true", help="store this run as the baseline")
+    parser.add_argument("--frame-threshold", type=float, default=0.10,
+                        help="allowed frame time regression (default 0.10 = 10%%)")
+    parser.add_argument("--boot-threshold", type=float, default=0.10,
+                        help="allowed boot to first frame regression (default 0.10 = 10%%)")
+    parser.add_argument("--timeout", type=float, default=300, help="seconds before giving up")
+    args = parser.parse_args()
+
+    command = [part.replace("{rom}", args.rom) for part in shlex.split(args.emulator)]
+
+    try:
+        boot_ticks, frames, ended = run_emulator(command, args.timeout)
+    except OSError as error:
+        print("cannot run the emulator: %s" % error)
+        return 2
+
+    if not ended:
+        print("the input script did not finish (%d frames traced), is the debug output enabled?" % len(frames))
+        return 2
+
+    result = summarize(boot_ticks, frames)
+
+    if result is None:
+        print("no boot time or game frames in the trace")
+        return 2
+
+    print("boot to first frame: %.2f ms" % ms(result["boot_ticks"]))
+    print("game frames:         %d" % result["game_frames"])
+    print("frame time:          %.3f ms mean, %.3f ms p95, %.3f ms max" % (
+        ms(result["frame_ticks_mean"]), ms(result["frame_ticks_p95"]), ms(result["frame_ticks_max"])))
+
+    if args.update_baseline:
+        with open(args.baseline, "w") as f:
+            json.dump(result, f, indent=4, sort_keys=True)
+            f.write("\n")
+        print("baseline stored in %s" % args.baseline)
+        return 0
+
+    if not os.path.exists(args.baseline):
+        print("no baseline in %s, run with --update-baseline first" % args.baseline)
+        return 2
+
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+
+    failed = False
+
+    for key, threshold in (("boot_ticks", args.boot_threshold),
+                           ("frame_ticks_mean", args.frame_threshold),
+                           ("frame_ticks_p95", args.frame_threshold)):
+
+        limit = baseline[key] * (1 + threshold)
+        status = "ok"
+
+        if result[key] > limit:
+            status = "REGRESSION"
+            failed = True
+
+        print("%-17s %10.0f ticks (baseline %10.0f, limit %10.0f) %s" % (
+            key, result[key], baseline[key], limit, status))
+
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,316 @@
+/*---------------------------------------------------------------------------------
+
+PongDS - Simple Pong-like game for the Nintendo DS
+
+Host tool that decodes the telemetry files written by the game
+(pongds_telemetry.bin in the root of the SD card) and prints per match
+and aggregated statistics about the rallies.
+
+Build: cc -O2 -o telemetry_decode tools/telemetry_decode.c
+Usage: telemetry_decode [-v] pongds_telemetry.bin [more files...]
+
+Author: Asier Iturralde Sarasola
+License: GPL v3
+
+---------------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Must match include/telemetry.h
+#define TELEMETRY_VERSION 1
+#define HEADER_SIZE 32
+#define EVENT_SIZE 12
+
+#define TELEMETRY_SERVE 0
+#define TELEMETRY_PADDLE_HIT 1
+#define TELEMETRY_WALL_BOUNCE 2
+#define TELEMETRY_GOAL 3
+#define TELEMETRY_FRAME_TIME 4
+#define TELEMETRY_MUSIC 5
+#define TELEMETRY_PADDLE_LATENCY 6
+#define TELEMETRY_POWER 7
+
+// enum telemetry_power_metrics
+#define POWER_METRICS 4
+
+// enum control_schemes of include/paddle_control.h
+#define CONTROL_SCHEMES 3
+static const char *scheme_names[CONTROL_SCHEMES] = {"digital", "accel", "touch"};
+
+// Bus clock of the DS in Hz, the frame times are measured in its ticks
+#define BUS_CLOCK 33513982.0
+
+// Bus clock ticks in a frame (about 16.7 ms)
+#define FRAME_TICKS 560190
+
+#define HIT_Y_BUCKETS 6     // hit_y goes from 0 to 47, 8 pixels per bucket
+#define ANGLE_BUCKETS 12    // 30 degrees per bucket
+
+typedef struct {
+    unsigned long matches;
+    unsigned long frames;
+    unsigned long dropped;
+    unsigned long rallies;
+    unsigned long hits;
+    unsigned long max_rally_hits;
+    unsigned long wall_bounces;
+    unsigned long frame_samples;
+    double frame_us_total;
+    double frame_us_max;
+    unsigned long music_samples;
+    unsigned long music_underruns;
+    long music_min_fill;
+    unsigned long response_samples[CONTROL_SCHEMES];
+    unsigned long response_frames[CONTROL_SCHEMES];
+    unsigned long response_max[CONTROL_SCHEMES];
+    unsigned long power_matches;
+    unsigned long power[POWER_METRICS];     // active frames, idle frames, sleeps, seconds asleep
+    unsigned long hit_y[HIT_Y_BUCKETS];
+    unsigned long angles[ANGLE_BUCKETS];
+} stats;
+
+static unsigned int u16le(const unsigned char *p) {
+    return p[0] | (p[1] << 8);
+}
+
+static unsigned long u32le(const unsigned char *p) {
+    return (unsigned long) p[0] | ((unsigned long) p[1] << 8) | ((unsigned long) p[2] << 16) | ((unsigned long) p[3] << 24);
+}
+
+static long s32le(const unsigned char *p) {
+    unsigned long v = u32le(p);
+    return v & 0x80000000UL ? (long) (v - 0x100000000UL) : (long) v;
+}
+
+static int s16le(const unsigned char *p) {
+    unsigned int v = u16le(p);
+    return v & 0x8000 ? (int) v - 0x10000 : (int) v;
+}
+
+static int angleBucket(long angle) {
+    angle %= 360;
+    if (angle < 0) {
+        angle += 360;
+    }
+    return angle / (360 / ANGLE_BUCKETS);
+}
+
+//---------------------------------------------------------------------
+// Decodes every match of a file and adds it to the statistics
+//---------------------------------------------------------------------
+static int decodeFile(const char *path, stats *st, int verbose) {
+
+    unsigned char header[HEADER_SIZE];
+    unsigned char event[EVENT_SIZE];
+    FILE *f = fopen(path, "rb");
+
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    while (fread(header, HEADER_SIZE, 1, f) == 1) {
+
+        unsigned long count, i;
+        unsigned long rally_hits = 0, rally_bounces = 0;
+        int in_rally = 0;
+
+        if (memcmp(header, "PDST", 4) != 0) {
+            fprintf(stderr, "%s: bad magic, stopping\n", path);
+            break;
+        }
+
+        if (u16le(header + 4) != TELEMETRY_VERSION || u16le(header + 6) != EVENT_SIZE) {
+            fprintf(stderr, "%s: unsupported version %u, stopping\n", path, u16le(header + 4));
+            break;
+        }
+
+        count = u32le(header + 16);
+
+        st->matches++;
+        st->frames += u32le(header + 12);
+        st->dropped += u32le(header + 20);
+
+        if (verbose) {
+            printf("match %lu: %s, %lu frames, %lu events (%lu dropped), score %ld-%ld\n",
+                   st->matches, u32le(header + 8) == 2 ? "1P" : "2P",
+                   u32le(header + 12), count, u32le(header + 20),
+                   s32le(header + 24), s32le(header + 28));
+        }
+
+        for (i = 0; i < count; i++) {
+
+            long c;
+            int b;
+
+            if (fread(event, EVENT_SIZE, 1, f) != 1) {
+                fprintf(stderr, "%s: truncated match\n", path);
+                fclose(f);
+                return -1;
+            }
+
+            b = s16le(event + 6);
+            c = s32le(event + 8);
+
+            switch (event[4]) {
+
+                case TELEMETRY_SERVE:
+                    in_rally = 1;
+                    rally_hits = 0;
+                    rally_bounces = 0;
+                    break;
+
+                case TELEMETRY_PADDLE_HIT:
+                    st->hits++;
+                    rally_hits++;
+                    if (b >= 0 && b / 8 < HIT_Y_BUCKETS) {
+                        st->hit_y[b / 8]++;
+                    }
+                    st->angles[angleBucket(c)]++;
+                    break;
+
+                case TELEMETRY_WALL_BOUNCE:
+                    st->wall_bounces++;
+                    rally_bounces++;
+                    break;
+
+                case TELEMETRY_GOAL:
+                    if (in_rally) {
+                        st->rallies++;
+                        if (rally_hits > st->max_rally_hits) {
+                            st->max_rally_hits = rally_hits;
+                        }
+                        if (verbose) {
+                            printf("  rally: %lu hits, %lu wall bounces, point for P%d\n",
+                                   rally_hits, rally_bounces, event[5]);
+                        }
+                    }
+                    in_rally = 0;
+                    break;
+
+                case TELEMETRY_FRAME_TIME: {
+                    double us = c * 1000000.0 / BUS_CLOCK;
+                    st->frame_samples++;
+                    st->frame_us_total += us;
+                    if (us > st->frame_us_max) {
+                        st->frame_us_max = us;
+                    }
+                    break;
+                }
+
+                case TELEMETRY_MUSIC:
+                    st->music_underruns += b;
+                    if (st->music_samples == 0 || c < st->music_min_fill) {
+                        st->music_min_fill = c;
+                    }
+                    st->music_samples++;
+                    break;
+
+                case TELEMETRY_POWER:
+                    if (event[5] < POWER_METRICS) {
+                        st->power[event[5]] += c;
+                        if (event[5] == 0) {
+                            st->power_matches++;
+                        }
+                    }
+                    break;
+
+                case TELEMETRY_PADDLE_LATENCY:
+                    if (event[5] < CONTROL_SCHEMES && b > 0) {
+                        st->response_samples[event[5]]++;
+                        st->response_frames[event[5]] += b;
+                        if ((unsigned long) b > st->response_max[event[5]]) {
+                            st->response_max[event[5]] = b;
+                        }
+                    }
+                    break;
+
+                default:
+                    break;
+            }
+        }
+    }
+
+    fclose(f);
+
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+
+    stats st;
+    int verbose = 0;
+    int i, status = 0;
+
+    memset(&st, 0, sizeof(st));
+
+    if (argc > 1 && strcmp(argv[1], "-v") == 0) {
+        verbose = 1;
+        argv++;
+        argc--;
+    }
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: telemetry_decode [-v] pongds_telemetry.bin [more files...]\n");
+        return 2;
+    }
+
+    for (i = 1; i < argc; i++) {
+        if (decodeFile(argv[i], &st, verbose) != 0) {
+            status = 1;
+        }
+    }
+
+    printf("matches:            %lu\n", st.matches);
+    printf("frames played:      %lu (%.1f minutes)\n", st.frames, st.frames / 60.0 / 60.0);
+    printf("dropped events:     %lu\n", st.dropped);
+    printf("rallies:            %lu\n", st.rallies);
+
+    if (st.rallies > 0) {
+        printf("hits per rally:     %.2f (max %lu)\n", (double) st.hits / st.rallies, st.max_rally_hits);
+        printf("bounces per rally:  %.2f\n", (double) st.wall_bounces / st.rallies);
+    }
+
+    if (st.frame_samples > 0) {
+        printf("frame time:         %.1f us average, %.1f us max (%lu samples)\n",
+               st.frame_us_total / st.frame_samples, st.frame_us_max, st.frame_samples);
+    }
+
+    if (st.music_samples > 0) {
+        printf("music underruns:    %lu (lowest ring fill %ld bytes)\n", st.music_underruns, st.music_min_fill);
+    }
+
+    if (st.power_matches > 0 && st.power[0] + st.power[1] > 0) {
+        printf("idle frames:        %.1f%% (%lu active, %lu idle)\n",
+               100.0 * st.power[1] / (st.power[0] + st.power[1]), st.power[0], st.power[1]);
+        printf("sleeps:             %lu (%lu seconds asleep)\n", st.power[2], st.power[3]);
+    }
+
+    for (i = 0; i < CONTROL_SCHEMES; i++) {
+        if (st.response_samples[i] > 0) {
+            double frames = (double) st.response_frames[i] / st.response_samples[i];
+            printf("%-7s response:   %.2f frames (%.1f ms) average, %lu frames max (%lu inputs)\n",
+                   scheme_names[i], frames, frames * FRAME_TICKS * 1000.0 / BUS_CLOCK,
+                   st.response_max[i], st.response_samples[i]);
+        }
+    }
+
+    if (st.hits > 0) {
+
+        printf("hit_y distribution:\n");
+        for (i = 0; i < HIT_Y_BUCKETS; i++) {
+            printf("  %2d-%2d: %5.1f%%\n", i * 8, i * 8 + 7, 100.0 * st.hit_y[i] / st.hits);
+        }
+
+        printf("return angle distribution:\n");
+        for (i = 0; i < ANGLE_BUCKETS; i++) {
+            if (st.angles[i] > 0) {
+                printf("  %3d-%3d: %5.1f%%\n", i * 30, i * 30 + 29, 100.0 * st.angles[i] / st.hits);
+            }
+        }
+    }
+
+    return status;
+}